@@ -0,0 +1,70 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Host test of the BCD codec against the division based code it replaced.
+// In test/: make bcd_test && ./bcd_test
+
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <Arduino.h>
+#include "bcd.h"
+#include "rig.h"
+
+static void ref_freq2bcd(int32_t freq, uint8_t *bcd) {
+  uint8_t lo, hi;
+  for (int8_t i = 0; i < FREQ_BCD_LEN; i ++) {
+    lo = freq % 10;
+    freq /= 10;
+    hi = freq % 10;
+    freq /= 10;
+
+    bcd[i] = (hi << 4) + lo;
+  }
+}
+
+static void ref_format_freq(char *buf, int32_t freq) {
+  sprintf(buf, "%2" PRIu32 ".%05" PRIi32, (uint32_t)(freq / 1000000), (freq % 1000000) / 10);
+}
+
+int main() {
+  uint8_t bcd[FREQ_BCD_LEN], ref_bcd[FREQ_BCD_LEN];
+  char buf[17], ref_buf[17];
+  uint32_t errors = 0;
+
+  for (int32_t freq = MIN_FREQ; freq <= MAX_FREQ; freq += 10) {
+    freq2bcd(freq, bcd);
+    ref_freq2bcd(freq, ref_bcd);
+    format_freq(buf, freq);
+    ref_format_freq(ref_buf, freq);
+
+    if (memcmp(bcd, ref_bcd, FREQ_BCD_LEN) != 0 || bcd2freq(bcd) != freq || strcmp(buf, ref_buf) != 0) {
+      if (errors ++ < 10) printf("freq %" PRIi32 ": \"%s\", expected \"%s\"\n", freq, buf, ref_buf);
+    }
+  }
+
+  for (uint16_t val = 0; val < 256; val ++) {
+    uint8_t b[2];
+
+    byte2bcd(val, b);
+    if (b[0] != val / 100 || b[1] != (((val % 100) / 10) << 4) + (val % 10) || bcd2byte(b) != val) {
+      if (errors ++ < 10) printf("byte %u\n", val);
+    }
+  }
+
+  printf("%s: %" PRIu32 " errors\n", errors == 0 ? "PASS" : "FAIL", errors);
+
+  return errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,131 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// The parts of the Arduino API used by the firmware, for host builds.
+// The plain C modules need only the PROGMEM macros. The simulator in
+// test/sim implements the rest.
+
+#ifndef __ARDUINO_H__
+#define __ARDUINO_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+// no separate flash on the host
+#define PROGMEM
+typedef const char *PGM_P;
+#define PSTR(s) (s)
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
+#define pgm_read_word(p) (*(const uint16_t *)(p))
+#define pgm_read_dword(p) (*(const uint32_t *)(p))
+#define memcpy_P memcpy
+#define strcpy_P strcpy
+#define strlen_P strlen
+
+class __FlashStringHelper;
+#define F(s) ((const __FlashStringHelper *)(s))
+
+#define HIGH (1)
+#define LOW (0)
+
+#define INPUT (0)
+#define OUTPUT (1)
+#define INPUT_PULLUP (2)
+
+#define DEFAULT (1)
+
+// Nano pin numbers
+#define A0 (14)
+#define A1 (15)
+#define A2 (16)
+#define A3 (17)
+#define A4 (18)
+#define A5 (19)
+#define A6 (20)
+#define A7 (21)
+#define LED_BUILTIN (13)
+#define NUM_PINS (22)
+
+#define SERIAL_8N1 (0x06)
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+void analogReference(uint8_t mode);
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void tone(uint8_t pin, unsigned int freq, unsigned long duration = 0);
+void noTone(uint8_t pin);
+
+void noInterrupts();
+void interrupts();
+
+class Print {
+public:
+  virtual ~Print() {};
+
+  virtual size_t write(uint8_t c) = 0;
+
+  size_t write(const uint8_t *buf, size_t len) {
+    for (size_t i = 0; i < len; i ++) write(buf[i]);
+    return len;
+  };
+
+  size_t print(const char *s) { return write((const uint8_t *)s, strlen(s)); };
+  size_t print(const __FlashStringHelper *s) { return print((const char *)s); };
+  size_t print(char c) { return write((uint8_t)c); };
+  size_t print(long n) { char buf[12]; sprintf(buf, "%ld", n); return print(buf); };
+  size_t print(unsigned long n) { char buf[12]; sprintf(buf, "%lu", n); return print(buf); };
+  size_t print(int n) { return print((long)n); };
+  size_t print(unsigned int n) { return print((unsigned long)n); };
+
+  size_t println() { return print("\r\n"); };
+  size_t println(const char *s) { return print(s) + println(); };
+  size_t println(const __FlashStringHelper *s) { return print(s) + println(); };
+};
+
+class HardwareSerial : public Print {
+public:
+  void begin(unsigned long baud, uint8_t config = SERIAL_8N1);
+  void end();
+
+  int available();
+  int read();
+  int peek();
+  size_t readBytes(uint8_t *buf, size_t len);
+
+  int availableForWrite();
+  virtual size_t write(uint8_t c);
+  using Print::write;
+  void flush();
+
+  operator bool() { return true; };
+};
+
+extern HardwareSerial Serial;
+
+#endif // __ARDUINO_H__
@@ -0,0 +1,53 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Arduino EEPROM over a RAM image of the 1K ATmega328 EEPROM
+
+#ifndef __EEPROM_H__
+#define __EEPROM_H__
+
+#include <Arduino.h>
+
+#define EEPROM_SIM_SIZE (1024)
+
+class EEPROMClass {
+public:
+  uint8_t read(int addr) { return _data[addr]; };
+  void write(int addr, uint8_t val);
+  void update(int addr, uint8_t val) { if (_data[addr] != val) write(addr, val); };
+
+  template <typename T> T &get(int addr, T &t) {
+    memcpy(&t, &_data[addr], sizeof(T));
+    return t;
+  };
+
+  template <typename T> const T &put(int addr, const T &t) {
+    const uint8_t *p = (const uint8_t *)&t;
+    for (size_t i = 0; i < sizeof(T); i ++) update(addr + i, p[i]);
+    return t;
+  };
+
+  uint16_t length() { return EEPROM_SIM_SIZE; };
+
+  uint8_t *data() { return _data; };
+  uint32_t writes() { return _writes; };
+private:
+  uint8_t _data[EEPROM_SIM_SIZE];
+  uint32_t _writes;
+};
+
+extern EEPROMClass EEPROM;
+
+#endif // __EEPROM_H__
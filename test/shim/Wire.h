@@ -0,0 +1,36 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Arduino Wire, master writes only. The simulator routes them to its
+// virtual Si5351.
+
+#ifndef __WIRE_H__
+#define __WIRE_H__
+
+#include <Arduino.h>
+
+class TwoWire {
+public:
+  void begin();
+  void setClock(uint32_t clock);
+
+  void beginTransmission(uint8_t addr);
+  size_t write(uint8_t val);
+  uint8_t endTransmission(bool stop = true);
+};
+
+extern TwoWire Wire;
+
+#endif // __WIRE_H__
@@ -0,0 +1,70 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// FsmOs (https://github.com/qiwenmin/fsmos), as the firmware uses it.
+// A state change runs on_state_change() on the next pass of the task, and
+// in_state() is called on every pass while no delay is pending.
+
+#ifndef __FSMOS_H__
+#define __FSMOS_H__
+
+#include <Arduino.h>
+
+#define FSM_STATE_NONE (-1)
+#define FSM_STATE_DELAY (-2)
+#define FSM_STATE_USERDEF (0)
+
+class FsmTask {
+public:
+  FsmTask();
+  virtual ~FsmTask() {};
+
+  virtual void init() = 0;
+  virtual bool on_state_change(int8_t new_state, int8_t old_state) = 0;
+  virtual void in_state(int8_t state) = 0;
+
+  void loop();
+
+  int8_t getState() { return _state; };
+
+  void gotoState(int8_t state);
+  void gotoStateForce(int8_t state);
+
+  // Pauses the task for ms, then goes to state
+  void delay(unsigned long ms, int8_t state);
+private:
+  int8_t _state;
+  int8_t _next_state;
+  bool _force;
+  bool _delaying;
+  unsigned long _delay_from, _delay_ms;
+
+  void changeState();
+};
+
+class FsmOs {
+public:
+  FsmOs(uint8_t max_tasks);
+
+  void addTask(FsmTask *task);
+  void init();
+  void loop();
+private:
+  uint8_t _max_tasks;
+  uint8_t _task_count;
+  FsmTask **_tasks;
+};
+
+#endif // __FSMOS_H__
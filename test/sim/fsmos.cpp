@@ -0,0 +1,90 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <fsmos.h>
+
+#include "sim.h"
+
+FsmTask::FsmTask() {
+  _state = FSM_STATE_NONE;
+  _next_state = FSM_STATE_NONE;
+  _force = false;
+  _delaying = false;
+  _delay_from = _delay_ms = 0;
+}
+
+void FsmTask::gotoState(int8_t state) {
+  _next_state = state;
+  _force = false;
+  _delaying = false;
+}
+
+void FsmTask::gotoStateForce(int8_t state) {
+  _next_state = state;
+  _force = true;
+  _delaying = false;
+}
+
+void FsmTask::delay(unsigned long ms, int8_t state) {
+  _next_state = state;
+  _force = false;
+  _delaying = true;
+  _delay_from = millis();
+  _delay_ms = ms;
+}
+
+void FsmTask::changeState() {
+  int8_t new_state = _next_state;
+  bool force = _force;
+
+  _next_state = FSM_STATE_NONE;
+  _force = false;
+
+  // on_state_change may go on to another state or delay
+  if (on_state_change(new_state, _state) || force) _state = new_state;
+}
+
+void FsmTask::loop() {
+  if (_delaying) {
+    if (millis() - _delay_from < _delay_ms) return;
+    _delaying = false;
+  }
+
+  if (_next_state != FSM_STATE_NONE) {
+    changeState();
+  } else if (_state != FSM_STATE_NONE) {
+    in_state(_state);
+  }
+}
+
+FsmOs::FsmOs(uint8_t max_tasks) {
+  _max_tasks = max_tasks;
+  _task_count = 0;
+  _tasks = new FsmTask *[max_tasks];
+}
+
+void FsmOs::addTask(FsmTask *task) {
+  if (_task_count < _max_tasks) _tasks[_task_count ++] = task;
+}
+
+void FsmOs::init() {
+  for (uint8_t i = 0; i < _task_count; i ++) _tasks[i]->init();
+}
+
+void FsmOs::loop() {
+  for (uint8_t i = 0; i < _task_count; i ++) _tasks[i]->loop();
+
+  sim_advance_us(SIM_LOOP_US);
+}
@@ -0,0 +1,207 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// ubitx-sim [-t ms] [-e eeprom.bin] [script]
+//
+// Runs the firmware from power on. The script has one event per line,
+// in time order:
+//
+//   <ms> pin <A0..A7|n> <0..1023>  set an input
+//   <ms> serial <hex bytes...>     the CAT controller sends
+//   <ms> baud <n>                  the CAT controller's baud rate
+//   <ms> enc <steps> [ms]          turn the encoder, 10ms per step by default
+//   <ms> lcd                       log the LCD
+//   <ms> quit
+//
+// '#' starts a comment.
+
+#include <unistd.h>
+#include <ctype.h>
+
+#include <Arduino.h>
+#include <EEPROM.h>
+
+#include "sim.h"
+
+void setup();
+void loop();
+
+#define MAX_EVENTS (1024)
+#define MAX_LINE (256)
+
+typedef struct {
+  uint32_t at; // ms
+  char line[MAX_LINE];
+} Event;
+
+static Event events[MAX_EVENTS];
+static uint16_t event_count = 0;
+static uint16_t event_next = 0;
+
+static const char *eeprom_path = NULL;
+
+// the encoder being turned
+static int16_t enc_steps = 0;
+static uint32_t enc_step_us = 0;
+static uint64_t enc_next_at = 0;
+static uint8_t enc_ab = 3;
+
+static char lcd_last[2][17];
+
+void sim_exit() {
+  sim_log("END eeprom_writes=%lu rx_overruns=%lu",
+    (unsigned long)EEPROM.writes(), (unsigned long)sim_serial_overruns());
+
+  if (eeprom_path != NULL && !sim_eeprom_save(eeprom_path)) {
+    fprintf(stderr, "cannot write %s\n", eeprom_path);
+    exit(1);
+  }
+
+  exit(0);
+}
+
+static int parse_pin(const char *s) {
+  if (toupper(s[0]) == 'A' && s[1] >= '0' && s[1] <= '7') return A0 + s[1] - '0';
+  return atoi(s);
+}
+
+static void load_script(const char *path) {
+  FILE *f = fopen(path, "r");
+  if (f == NULL) {
+    fprintf(stderr, "cannot read %s\n", path);
+    exit(1);
+  }
+
+  char line[MAX_LINE];
+  while (fgets(line, sizeof(line), f) != NULL && event_count < MAX_EVENTS) {
+    char *p = strchr(line, '#');
+    if (p != NULL) *p = 0;
+
+    unsigned long at;
+    int n;
+    if (sscanf(line, "%lu %n", &at, &n) != 1) continue;
+
+    events[event_count].at = at;
+    strncpy(events[event_count].line, line + n, MAX_LINE - 1);
+    event_count ++;
+  }
+
+  fclose(f);
+}
+
+static void run_event(char *line) {
+  char *cmd = strtok(line, " \t\r\n");
+  if (cmd == NULL) return;
+
+  if (strcmp(cmd, "pin") == 0) {
+    char *pin = strtok(NULL, " \t\r\n");
+    char *val = strtok(NULL, " \t\r\n");
+    if (pin != NULL && val != NULL) sim_set_pin(parse_pin(pin), atoi(val));
+  } else if (strcmp(cmd, "serial") == 0) {
+    uint8_t buf[MAX_LINE / 2];
+    uint16_t len = 0;
+    char *hex;
+    while ((hex = strtok(NULL, " \t\r\n")) != NULL) buf[len ++] = strtoul(hex, NULL, 16);
+    sim_serial_inject(buf, len);
+  } else if (strcmp(cmd, "baud") == 0) {
+    char *baud = strtok(NULL, " \t\r\n");
+    if (baud != NULL) sim_set_line_baud(atol(baud));
+  } else if (strcmp(cmd, "enc") == 0) {
+    char *steps = strtok(NULL, " \t\r\n");
+    char *ms = strtok(NULL, " \t\r\n");
+    if (steps != NULL) {
+      enc_steps = atoi(steps);
+      enc_step_us = (ms != NULL ? atol(ms) : 10) * 1000;
+      enc_next_at = sim_now_us();
+    }
+  } else if (strcmp(cmd, "lcd") == 0) {
+    sim_log("LCD |%s|%s|", sim_lcd_row(0), sim_lcd_row(1));
+  } else if (strcmp(cmd, "quit") == 0) {
+    sim_exit();
+  } else {
+    fprintf(stderr, "unknown command: %s\n", cmd);
+    exit(1);
+  }
+}
+
+// one Gray code step, decoded as +1 by the firmware for 0 1 3 2
+static void enc_update() {
+  static const uint8_t fwd[4] = {1, 3, 0, 2};
+  static const uint8_t rev[4] = {2, 0, 3, 1};
+
+  if (enc_steps == 0 || sim_now_us() < enc_next_at) return;
+
+  if (enc_steps > 0) {
+    enc_ab = fwd[enc_ab];
+    enc_steps --;
+  } else {
+    enc_ab = rev[enc_ab];
+    enc_steps ++;
+  }
+
+  sim_set_pin(A0, (enc_ab & 1) ? 1023 : 0);
+  sim_set_pin(A1, (enc_ab & 2) ? 1023 : 0);
+  enc_next_at += enc_step_us;
+}
+
+static void lcd_update() {
+  if (strcmp(lcd_last[0], sim_lcd_row(0)) == 0 && strcmp(lcd_last[1], sim_lcd_row(1)) == 0) return;
+
+  strcpy(lcd_last[0], sim_lcd_row(0));
+  strcpy(lcd_last[1], sim_lcd_row(1));
+  sim_log("LCD |%s|%s|", lcd_last[0], lcd_last[1]);
+}
+
+int main(int argc, char *argv[]) {
+  int opt;
+
+  while ((opt = getopt(argc, argv, "t:e:")) != -1) {
+    switch (opt) {
+    case 't':
+      sim_set_end_ms(atol(optarg));
+      break;
+    case 'e':
+      eeprom_path = optarg;
+      break;
+    default:
+      fprintf(stderr, "usage: %s [-t ms] [-e eeprom.bin] [script]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  if (optind < argc) load_script(argv[optind]);
+
+  // a new chip is erased, and the inputs are pulled up
+  memset(EEPROM.data(), 0xFF, EEPROM_SIM_SIZE);
+  if (eeprom_path != NULL) sim_eeprom_load(eeprom_path);
+
+  for (uint8_t pin = 0; pin < NUM_PINS; pin ++) sim_set_pin(pin, 1023);
+
+  setup();
+
+  for (;;) {
+    while (event_next < event_count && (uint64_t)events[event_next].at * 1000 <= sim_now_us()) {
+      run_event(events[event_next ++].line);
+    }
+
+    enc_update();
+
+    loop();
+
+    lcd_update();
+  }
+
+  return 0;
+}
@@ -0,0 +1,438 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdarg.h>
+#include <math.h>
+
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <Wire.h>
+#include <LiquidCrystal.h>
+
+#include "sim.h"
+
+HardwareSerial Serial;
+EEPROMClass EEPROM;
+TwoWire Wire;
+
+/////////////
+// Time
+
+static uint64_t sim_us = 0;
+static uint64_t sim_end_us = 0;
+
+static void serial_update();
+
+uint64_t sim_now_us() {
+  return sim_us;
+}
+
+void sim_advance_us(uint32_t us) {
+  sim_us += us;
+  serial_update();
+
+  if (sim_end_us != 0 && sim_us >= sim_end_us) sim_exit();
+}
+
+void sim_set_end_ms(uint32_t ms) {
+  sim_end_us = (uint64_t)ms * 1000;
+}
+
+void sim_log(const char *fmt, ...) {
+  va_list ap;
+
+  printf("%10.3f ", sim_us / 1000000.0);
+
+  va_start(ap, fmt);
+  vprintf(fmt, ap);
+  va_end(ap);
+
+  printf("\n");
+}
+
+unsigned long millis() {
+  return (unsigned long)(sim_us / 1000);
+}
+
+unsigned long micros() {
+  return (unsigned long)sim_us;
+}
+
+void delay(unsigned long ms) {
+  sim_advance_us(ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us) {
+  sim_advance_us(us);
+}
+
+void noInterrupts() {
+}
+
+void interrupts() {
+}
+
+/////////////
+// Pins
+
+static int pin_val[NUM_PINS];
+static uint8_t pin_mode[NUM_PINS];
+static uint8_t pin_out[NUM_PINS];
+
+void sim_set_pin(uint8_t pin, int val) {
+  if (pin < NUM_PINS) pin_val[pin] = val;
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  if (pin < NUM_PINS) pin_mode[pin] = mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+  if (pin >= NUM_PINS) return;
+
+  val = val ? HIGH : LOW;
+  if (pin_mode[pin] == OUTPUT && pin_out[pin] != val) sim_log("PIN %u %u", pin, val);
+
+  pin_out[pin] = val;
+}
+
+int digitalRead(uint8_t pin) {
+  if (pin >= NUM_PINS) return LOW;
+  if (pin_mode[pin] == OUTPUT) return pin_out[pin];
+
+  return pin_val[pin] >= 512 ? HIGH : LOW;
+}
+
+int analogRead(uint8_t pin) {
+  if (pin >= NUM_PINS) return 0;
+
+  sim_advance_us(2); // part of the 100us conversion is spent in the call
+
+  return pin_val[pin];
+}
+
+void analogReference(uint8_t) {
+}
+
+void tone(uint8_t pin, unsigned int freq, unsigned long) {
+  sim_log("TONE %u %u", pin, freq);
+}
+
+void noTone(uint8_t pin) {
+  sim_log("TONE %u off", pin);
+}
+
+/////////////
+// Serial: the UART's 64 byte buffers, filled and drained at the baud rate
+
+#define SERIAL_BUFFER_SIZE (64)
+#define LINE_QUEUE_SIZE (4096)
+
+static uint32_t serial_baud = 0; // 0: not begun
+static uint32_t line_baud = 19200;
+
+static uint8_t line_q[LINE_QUEUE_SIZE]; // sent by the controller, on the line
+static uint16_t line_head = 0, line_len = 0;
+static uint64_t line_next_at = 0; // when the next byte is complete
+
+static uint8_t rx_buf[SERIAL_BUFFER_SIZE];
+static uint8_t rx_head = 0, rx_len = 0;
+static uint32_t rx_overruns = 0;
+
+static uint16_t tx_len = 0; // bytes still in the TX buffer
+static uint64_t tx_next_at = 0;
+
+static uint8_t tx_frame[256];
+static uint16_t tx_frame_len = 0;
+
+static inline uint32_t byte_us(uint32_t baud) {
+  return 10000000UL / baud;
+}
+
+void sim_set_line_baud(uint32_t baud) {
+  line_baud = baud;
+}
+
+void sim_serial_inject(const uint8_t *data, uint16_t len) {
+  if (line_len == 0 && line_next_at < sim_us + byte_us(line_baud)) {
+    line_next_at = sim_us + byte_us(line_baud);
+  }
+
+  for (uint16_t i = 0; i < len && line_len < LINE_QUEUE_SIZE; i ++) {
+    line_q[(line_head + line_len) % LINE_QUEUE_SIZE] = data[i];
+    line_len ++;
+  }
+}
+
+static void tx_frame_log() {
+  char buf[256 * 3 + 4];
+  uint16_t pos = 0;
+
+  for (uint16_t i = 0; i < tx_frame_len; i ++) {
+    pos += sprintf(&buf[pos], " %02X", tx_frame[i]);
+  }
+  buf[pos] = 0;
+
+  sim_log("TX%s", buf);
+  tx_frame_len = 0;
+}
+
+static void serial_update() {
+  while (line_len > 0 && line_next_at <= sim_us) {
+    uint8_t c = line_q[line_head];
+    line_head = (line_head + 1) % LINE_QUEUE_SIZE;
+    line_len --;
+    line_next_at += byte_us(line_baud);
+
+    if (serial_baud == 0) continue;
+    if (serial_baud != line_baud) c ^= 0x5A; // framing garbage
+
+    if (rx_len < SERIAL_BUFFER_SIZE) {
+      rx_buf[(rx_head + rx_len) % SERIAL_BUFFER_SIZE] = c;
+      rx_len ++;
+    } else {
+      if (rx_overruns ++ == 0) sim_log("RX overrun");
+    }
+  }
+
+  while (tx_len > 0 && tx_next_at <= sim_us) {
+    tx_len --;
+    tx_next_at += byte_us(serial_baud);
+  }
+}
+
+uint32_t sim_serial_overruns() {
+  return rx_overruns;
+}
+
+void HardwareSerial::begin(unsigned long baud, uint8_t) {
+  serial_baud = baud;
+  rx_len = 0;
+  tx_len = 0;
+
+  sim_log("BAUD %lu", baud);
+}
+
+void HardwareSerial::end() {
+  serial_baud = 0;
+}
+
+int HardwareSerial::available() {
+  serial_update();
+  if (rx_len == 0) sim_advance_us(1); // a polling loop must see time pass
+
+  return rx_len;
+}
+
+int HardwareSerial::peek() {
+  serial_update();
+
+  return rx_len > 0 ? rx_buf[rx_head] : -1;
+}
+
+int HardwareSerial::read() {
+  serial_update();
+  if (rx_len == 0) return -1;
+
+  uint8_t c = rx_buf[rx_head];
+  rx_head = (rx_head + 1) % SERIAL_BUFFER_SIZE;
+  rx_len --;
+
+  return c;
+}
+
+size_t HardwareSerial::readBytes(uint8_t *buf, size_t len) {
+  size_t n = 0;
+
+  while (n < len && available() > 0) buf[n ++] = read();
+
+  return n;
+}
+
+int HardwareSerial::availableForWrite() {
+  serial_update();
+
+  return SERIAL_BUFFER_SIZE - 1 - tx_len;
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+  if (serial_baud == 0) return 0;
+
+  // blocks while the buffer is full, as the AVR core does
+  while (availableForWrite() == 0) sim_advance_us(byte_us(serial_baud));
+
+  if (tx_len == 0) tx_next_at = sim_us + byte_us(serial_baud);
+  tx_len ++;
+
+  tx_frame[tx_frame_len ++] = c;
+  if (c == 0xFD || c == '\n' || tx_frame_len == sizeof(tx_frame)) tx_frame_log();
+
+  return 1;
+}
+
+void HardwareSerial::flush() {
+  while (tx_len > 0) sim_advance_us(byte_us(serial_baud));
+}
+
+/////////////
+// EEPROM
+
+void EEPROMClass::write(int addr, uint8_t val) {
+  _data[addr] = val;
+  _writes ++;
+}
+
+bool sim_eeprom_load(const char *path) {
+  FILE *f = fopen(path, "rb");
+  if (f == NULL) return false;
+
+  bool ok = fread(EEPROM.data(), 1, EEPROM_SIM_SIZE, f) == EEPROM_SIM_SIZE;
+  fclose(f);
+
+  return ok;
+}
+
+bool sim_eeprom_save(const char *path) {
+  FILE *f = fopen(path, "wb");
+  if (f == NULL) return false;
+
+  bool ok = fwrite(EEPROM.data(), 1, EEPROM_SIM_SIZE, f) == EEPROM_SIM_SIZE;
+  fclose(f);
+
+  return ok;
+}
+
+/////////////
+// Si5351 at 0x60, with the registers the firmware writes
+
+#define SI5351_ADDR (0x60)
+#define SI5351_XTAL (25000000.0)
+
+static uint8_t si_regs[256];
+static uint32_t si_freq[3];
+
+static uint32_t i2c_clock = 100000;
+static uint8_t i2c_addr;
+static uint8_t i2c_buf[64];
+static uint8_t i2c_len;
+
+// a + b / c of a PLL or msynth block, from its 8 registers
+static double si_ratio(uint8_t reg) {
+  const uint8_t *r = &si_regs[reg];
+  uint32_t p1 = ((uint32_t)(r[2] & 0x03) << 16) | ((uint32_t)r[3] << 8) | r[4];
+  uint32_t p2 = ((uint32_t)(r[5] & 0x0F) << 16) | ((uint32_t)r[6] << 8) | r[7];
+  uint32_t p3 = ((uint32_t)(r[5] >> 4) << 16) | ((uint32_t)r[0] << 8) | r[1];
+
+  return (p1 + 512 + (p3 ? (double)p2 / p3 : 0)) / 128.0;
+}
+
+static void si_update() {
+  double vco = SI5351_XTAL * si_ratio(26);
+
+  for (uint8_t clk = 0; clk < 3; clk ++) {
+    uint32_t f = 0;
+
+    if (!(si_regs[3] & (1 << clk))) {
+      uint8_t reg = 42 + clk * 8;
+      f = (uint32_t)lround(vco / si_ratio(reg) / (1 << ((si_regs[reg + 2] >> 4) & 0x07)));
+    }
+
+    if (f != si_freq[clk]) {
+      si_freq[clk] = f;
+      sim_log("CLK%u %lu", clk, (unsigned long)f);
+    }
+  }
+}
+
+uint32_t sim_si5351_freq(uint8_t clk) {
+  return clk < 3 ? si_freq[clk] : 0;
+}
+
+void TwoWire::begin() {
+  memset(si_regs, 0, sizeof(si_regs));
+  si_regs[3] = 0xFF;
+}
+
+void TwoWire::setClock(uint32_t clock) {
+  i2c_clock = clock;
+}
+
+void TwoWire::beginTransmission(uint8_t addr) {
+  i2c_addr = addr;
+  i2c_len = 0;
+}
+
+size_t TwoWire::write(uint8_t val) {
+  if (i2c_len >= sizeof(i2c_buf)) return 0;
+
+  i2c_buf[i2c_len ++] = val;
+  return 1;
+}
+
+uint8_t TwoWire::endTransmission(bool) {
+  // start, address, the bytes and stop, 9 clocks each
+  sim_advance_us((uint32_t)((i2c_len + 2) * 9 * 1000000ULL / i2c_clock));
+
+  if (i2c_addr != SI5351_ADDR) return 2; // NACK on address
+
+  if (i2c_len > 0) {
+    for (uint8_t i = 1; i < i2c_len; i ++) si_regs[(uint8_t)(i2c_buf[0] + i - 1)] = i2c_buf[i];
+    si_update();
+  }
+
+  return 0;
+}
+
+/////////////
+// LCD
+
+static char lcd_text[2][17];
+static uint8_t lcd_col, lcd_row;
+
+LiquidCrystal::LiquidCrystal(uint8_t, uint8_t, uint8_t, uint8_t, uint8_t, uint8_t) {
+  clear();
+}
+
+void LiquidCrystal::begin(uint8_t, uint8_t) {
+  clear();
+}
+
+void LiquidCrystal::clear() {
+  memset(lcd_text, ' ', sizeof(lcd_text));
+  lcd_text[0][16] = lcd_text[1][16] = 0;
+  lcd_col = lcd_row = 0;
+}
+
+void LiquidCrystal::createChar(uint8_t, uint8_t[]) {
+}
+
+void LiquidCrystal::setCursor(uint8_t col, uint8_t row) {
+  lcd_col = col;
+  lcd_row = row & 0x01;
+}
+
+size_t LiquidCrystal::write(uint8_t c) {
+  sim_advance_us(SIM_LCD_WRITE_US);
+
+  if (lcd_col < 16) {
+    lcd_text[lcd_row][lcd_col ++] = c < 8 ? '*' : c; // custom chars
+  }
+
+  return 1;
+}
+
+const char *sim_lcd_row(uint8_t row) {
+  return lcd_text[row & 0x01];
+}
@@ -0,0 +1,50 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Host simulation of the uBitx board: virtual time, the Arduino pins, the
+// serial port, the EEPROM, the Si5351 and the LCD. The firmware runs on it
+// unchanged, see test/README.md.
+
+#ifndef __SIM_H__
+#define __SIM_H__
+
+#include <Arduino.h>
+
+// Virtual time. Nothing moves it but the firmware's own costs: every
+// FsmOs pass, I2C byte, LCD write and blocked serial write.
+#define SIM_LOOP_US (100) // one pass of the FsmOs loop
+#define SIM_LCD_WRITE_US (50)
+
+uint64_t sim_now_us();
+void sim_advance_us(uint32_t us);
+void sim_set_end_ms(uint32_t ms); // exits at this time, 0: never
+void sim_exit(); // by main.cpp
+
+// Inputs. Pins read 0..1023 by analogRead and LOW below 512 by digitalRead.
+void sim_set_pin(uint8_t pin, int val);
+void sim_serial_inject(const uint8_t *data, uint16_t len);
+void sim_set_line_baud(uint32_t baud); // the controller side
+
+// Outputs
+const char *sim_lcd_row(uint8_t row);
+uint32_t sim_si5351_freq(uint8_t clk); // 0 if the output is off
+bool sim_eeprom_load(const char *path);
+bool sim_eeprom_save(const char *path);
+uint32_t sim_serial_overruns();
+
+// Every event is logged to stdout as "<seconds> <what>"
+void sim_log(const char *fmt, ...);
+
+#endif // __SIM_H__
@@ -0,0 +1,98 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <Arduino.h>
+#include "adc_sampler.h"
+
+static uint8_t adc_pins[ADC_SAMPLER_SLOTS];
+static volatile int adc_values[ADC_SAMPLER_SLOTS];
+static uint8_t adc_count = 0;
+
+#ifdef __AVR__
+
+static volatile uint8_t adc_idx = 0;
+
+static inline void adc_start(uint8_t pin) {
+#if defined(analogPinToChannel)
+  uint8_t ch = analogPinToChannel(pin - A0);
+#else
+  uint8_t ch = pin - A0;
+#endif
+
+  ADMUX = _BV(REFS0) | (ch & 0x07); // AVcc, as analogReference(DEFAULT)
+  ADCSRA |= _BV(ADSC);
+}
+
+ISR(ADC_vect) {
+  uint8_t lo = ADCL; // ADCL first, it locks ADCH
+  uint8_t hi = ADCH;
+
+  adc_values[adc_idx] = (hi << 8) | lo;
+
+  adc_idx ++;
+  if (adc_idx >= adc_count) adc_idx = 0;
+
+  adc_start(adc_pins[adc_idx]);
+}
+
+int8_t adc_sampler_add(uint8_t pin) {
+  if (adc_count >= ADC_SAMPLER_SLOTS) return -1;
+
+  noInterrupts();
+
+  adc_pins[adc_count] = pin;
+  adc_values[adc_count] = 1023;
+  adc_count ++;
+
+  if (adc_count == 1) {
+    // the prescaler was set by the Arduino core, only the interrupt is new
+    ADCSRA |= _BV(ADEN) | _BV(ADIE);
+    adc_idx = 0;
+    adc_start(pin);
+  }
+
+  interrupts();
+
+  return adc_count - 1;
+}
+
+int adc_sampler_get(int8_t slot) {
+  if (slot < 0 || slot >= adc_count) return 1023;
+
+  noInterrupts();
+  int val = adc_values[slot];
+  interrupts();
+
+  return val;
+}
+
+#else
+
+int8_t adc_sampler_add(uint8_t pin) {
+  if (adc_count >= ADC_SAMPLER_SLOTS) return -1;
+
+  adc_pins[adc_count] = pin;
+  adc_values[adc_count] = 1023;
+
+  return adc_count ++;
+}
+
+int adc_sampler_get(int8_t slot) {
+  if (slot < 0 || slot >= adc_count) return 1023;
+
+  return analogRead(adc_pins[slot]);
+}
+
+#endif
@@ -0,0 +1,34 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __ADC_SAMPLER_H__
+#define __ADC_SAMPLER_H__
+
+#include <stdint.h>
+
+// Scans the analog inputs in the background and keeps the latest reading
+// of each, so the tasks never wait ~110us for analogRead(). On AVR every
+// conversion end interrupt stores the result and starts the next input.
+// Elsewhere adc_sampler_get() falls back to analogRead().
+
+#define ADC_SAMPLER_SLOTS (4)
+
+// Returns the slot of the pin, -1 if all slots are taken
+int8_t adc_sampler_add(uint8_t pin);
+
+// The latest reading, 1023 until the first conversion is done
+int adc_sampler_get(int8_t slot);
+
+#endif // __ADC_SAMPLER_H__
@@ -0,0 +1,114 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <Arduino.h>
+#include "bcd.h"
+
+#define DIGITS_LEN (10)
+
+static const uint32_t pow10_table[DIGITS_LEN - 1] PROGMEM = {
+  1000000000L, 100000000L, 10000000L, 1000000L, 100000L,
+  10000L, 1000L, 100L, 10L
+};
+
+// 10 decimal digits, the highest first. At most 9 subtractions per digit.
+static void to_digits(uint32_t val, uint8_t *digits) {
+  for (uint8_t i = 0; i < DIGITS_LEN - 1; i ++) {
+    uint32_t p = pgm_read_dword(&pow10_table[i]);
+    uint8_t d = 0;
+
+    while (val >= p) {
+      val -= p;
+      d ++;
+    }
+
+    digits[i] = d;
+  }
+
+  digits[DIGITS_LEN - 1] = val;
+}
+
+void num2bcd(uint32_t val, uint8_t *bcd, uint8_t len) {
+  uint8_t digits[DIGITS_LEN];
+
+  to_digits(val, digits);
+
+  for (uint8_t i = 0; i < len; i ++) {
+    bcd[i] = (digits[DIGITS_LEN - 2 - i * 2] << 4) + digits[DIGITS_LEN - 1 - i * 2];
+  }
+}
+
+void freq2bcd(int32_t freq, uint8_t *bcd) {
+  num2bcd(freq, bcd, FREQ_BCD_LEN);
+}
+
+int32_t bcd2freq(const uint8_t *bcd) {
+  int32_t ret_val = 0;
+  uint8_t lo, hi;
+  for (int8_t i = FREQ_BCD_LEN - 1; i >= 0; i --) {
+    lo = bcd[i] & 0x0F;
+    hi = (bcd[i] >> 4) & 0x0F;
+
+    ret_val = ret_val * 100 + hi * 10 + lo;
+  }
+
+  return ret_val;
+}
+
+void format_freq(char *buf, int32_t freq) {
+  uint8_t digits[DIGITS_LEN];
+  bool lead = true;
+
+  to_digits(freq, digits);
+
+  // MHz, at least 2 chars wide
+  for (uint8_t i = 0; i < 4; i ++) {
+    if (lead && digits[i] == 0 && i < 3) {
+      if (i == 2) *buf ++ = ' ';
+    } else {
+      lead = false;
+      *buf ++ = '0' + digits[i];
+    }
+  }
+
+  *buf ++ = '.';
+
+  for (uint8_t i = 4; i < DIGITS_LEN - 1; i ++) {
+    *buf ++ = '0' + digits[i];
+  }
+
+  *buf = 0;
+}
+
+void byte2bcd(uint8_t val, uint8_t *bcd) {
+  uint8_t h = 0, t = 0;
+
+  while (val >= 100) {
+    val -= 100;
+    h ++;
+  }
+
+  while (val >= 10) {
+    val -= 10;
+    t ++;
+  }
+
+  bcd[0] = h;
+  bcd[1] = (t << 4) + val;
+}
+
+uint8_t bcd2byte(const uint8_t *bcd) {
+  return (bcd[0] & 0x0F) * 100 + (bcd[1] >> 4) * 10 + (bcd[1] & 0x0F);
+}
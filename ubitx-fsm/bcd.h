@@ -0,0 +1,36 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __BCD_H__
+#define __BCD_H__
+
+#include <stdint.h>
+
+// CI-V frequency: 5 bytes BCD, the lowest digits first
+#define FREQ_BCD_LEN (5)
+
+// No 32 bit division: the digits are taken by subtracting powers of ten
+void freq2bcd(int32_t freq, uint8_t *bcd);
+void num2bcd(uint32_t val, uint8_t *bcd, uint8_t len); // the lowest first
+int32_t bcd2freq(const uint8_t *bcd);
+
+// "MM.kkkhh" - MHz, then kHz and the 10 Hz digits, as on the LCD
+void format_freq(char *buf, int32_t freq);
+
+// A byte as 3 BCD digits in 2 bytes: 0H TO
+void byte2bcd(uint8_t val, uint8_t *bcd);
+uint8_t bcd2byte(const uint8_t *bcd);
+
+#endif // __BCD_H__
@@ -0,0 +1,199 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bench.h"
+
+#if defined(UBITX_BENCH) && defined(__AVR__)
+
+#include <Arduino.h>
+#include <avr/sleep.h>
+#include "objs.h"
+#include "bcd.h"
+#include "cat_task.h"
+#include "display_task.h"
+#include "ui_tasks.h"
+#include "keyer_task.h"
+#include "rig.h"
+
+#define BENCH_RUNS (16)
+
+// Timer1 counts every cycle, its overflows extend it to 32 bits. Timer0 is
+// stopped while measuring, so the millis() interrupt doesn't count in.
+static volatile uint16_t bench_ovf;
+
+ISR(TIMER1_OVF_vect) {
+  bench_ovf ++;
+}
+
+static inline void bench_start() {
+  TIMSK0 &= ~_BV(TOIE0);
+
+  bench_ovf = 0;
+  TCNT1 = 0;
+  TCCR1B = _BV(CS10);
+}
+
+static inline uint32_t bench_stop() {
+  noInterrupts();
+
+  TCCR1B = 0;
+
+  uint32_t cycles = ((uint32_t)bench_ovf << 16) | TCNT1;
+  if (TIFR1 & _BV(TOV1)) {
+    cycles += 0x10000UL; // overflowed just before the stop
+    TIFR1 = _BV(TOV1);
+  }
+
+  TIMSK0 |= _BV(TOIE0);
+
+  interrupts();
+
+  return cycles;
+}
+
+typedef void (*BenchFunc)(uint8_t run);
+
+static uint32_t bench_overhead = 0;
+
+static void bench(const __FlashStringHelper *name, BenchFunc f) {
+  uint32_t min = 0xFFFFFFFFUL, max = 0, sum = 0;
+
+  for (uint8_t run = 0; run < BENCH_RUNS; run ++) {
+    bench_start();
+    (*f)(run);
+    uint32_t cycles = bench_stop() - bench_overhead;
+
+    if (cycles < min) min = cycles;
+    if (cycles > max) max = cycles;
+    sum += cycles;
+  }
+
+  Serial.print(name);
+  Serial.print(F(": min "));
+  Serial.print((unsigned long)min);
+  Serial.print(F(" avg "));
+  Serial.print((unsigned long)(sum / BENCH_RUNS));
+  Serial.print(F(" max "));
+  Serial.print((unsigned long)max);
+  Serial.println();
+  Serial.flush();
+}
+
+static void bench_empty(uint8_t) {
+}
+
+// CLK2 as the VFO drives it: 10 Hz steps, then band changes
+static void bench_stagefreq_step(uint8_t run) {
+  si5351bx_stagefreq(2, 52000000UL + run * 10);
+}
+
+static void bench_stagefreq_jump(uint8_t run) {
+  si5351bx_stagefreq(2, (run & 1) ? 52000000UL : 73000000UL);
+}
+
+static void bench_setfreq_step(uint8_t run) {
+  si5351bx_setfreq(2, 52000000UL + run * 10);
+}
+
+static void bench_update_hw_step(uint8_t run) {
+  Device::setFreqMode(7000000L + run * 10, MODE_USB, OFF);
+}
+
+static void bench_update_hw_same(uint8_t) {
+  Device::setFreqMode(7000000L, MODE_USB, OFF);
+}
+
+static void bench_update_hw_band(uint8_t run) {
+  Device::setFreqMode((run & 1) ? 7000000L : 14000000L, (run & 1) ? MODE_LSB : MODE_USB, OFF);
+}
+
+static uint8_t bench_bcd[FREQ_BCD_LEN];
+static volatile uint32_t bench_sink; // keeps LTO from dropping the calls
+
+static void bench_freq2bcd(uint8_t run) {
+  freq2bcd(29999990L - run * 1234567L, bench_bcd);
+}
+
+static void bench_bcd2freq(uint8_t) {
+  bench_sink = bcd2freq(bench_bcd);
+}
+
+class Bench {
+public:
+  static void rigDisplay(uint8_t) {
+    uiTask.update_rig_display();
+  };
+
+  static void morseGet(uint8_t run) {
+    bench_sink = keyerTask.get_or_compare_morse('A' + run);
+  };
+
+  // the reverse lookup goes through the table, '?' is near its end
+  static void morseCompare(uint8_t) {
+    bench_sink = keyerTask.get_or_compare_morse(0b00110010, false);
+  };
+};
+
+// All 32 characters changed, then none
+static void bench_display_all(uint8_t run) {
+  displayTask.print(0, 0, (run & 1) ? "0123456789ABCDEF" : "FEDCBA9876543210");
+  displayTask.print(0, 1, (run & 1) ? "0123456789ABCDEF" : "FEDCBA9876543210");
+  displayTask.on_state_change(UPDATE_DISPLAY, UPDATE_DISPLAY);
+}
+
+static void bench_display_none(uint8_t) {
+  displayTask.on_state_change(UPDATE_DISPLAY, UPDATE_DISPLAY);
+}
+
+void bench_run() {
+  // the keyer's CW timer used Timer1
+  noInterrupts();
+  TCCR1A = 0;
+  TCCR1B = 0;
+  TIMSK1 = _BV(TOIE1);
+  interrupts();
+
+  Serial.println(F("bench: cycles at 16MHz"));
+
+  bench_overhead = 0;
+  bench_start();
+  bench_empty(0);
+  bench_overhead = bench_stop();
+
+  bench(F("si5351bx_stagefreq step"), bench_stagefreq_step);
+  bench(F("si5351bx_stagefreq jump"), bench_stagefreq_jump);
+  bench(F("si5351bx_setfreq step"), bench_setfreq_step);
+  bench(F("Device::updateHardware step"), bench_update_hw_step);
+  bench(F("Device::updateHardware same"), bench_update_hw_same);
+  bench(F("Device::updateHardware band"), bench_update_hw_band);
+  bench(F("freq2bcd"), bench_freq2bcd);
+  bench(F("bcd2freq"), bench_bcd2freq);
+  bench(F("UiTask::update_rig_display"), Bench::rigDisplay);
+  bench(F("DisplayTask::on_state_change all"), bench_display_all);
+  bench(F("DisplayTask::on_state_change none"), bench_display_none);
+  bench(F("KeyerTask::get_or_compare_morse get"), Bench::morseGet);
+  bench(F("KeyerTask::get_or_compare_morse compare"), Bench::morseCompare);
+
+  Serial.println(F("bench: done"));
+  Serial.flush();
+
+  // simavr quits on a sleep with interrupts off
+  noInterrupts();
+  set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+  sleep_enable();
+  sleep_cpu();
+}
+
+#endif
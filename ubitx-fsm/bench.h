@@ -0,0 +1,30 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+#ifdef UBITX_BENCH
+
+// Prints the cycle counts of the hot paths over Serial and stops the CPU.
+// Built with -DUBITX_BENCH for the ATmega328, see test/README.md.
+void bench_run();
+
+// The private hot paths are reached through it
+class Bench;
+
+#endif
+
+#endif // __BENCH_H__
@@ -19,6 +19,8 @@
 #include <fsmos.h>
 #include "objs.h"
 #include "rig.h"
+#include "bcd.h"
+#include "keyer_task.h"
 
 #define FBC 0xFE // Frame begin char
 #define FEC 0xFD // Frame end char
@@ -26,34 +28,85 @@
 #define OKR 0xFB // OK Resp
 #define CMD(c) c
 
+#define CTRL_ADDR 0x00 // Address of the controller, for transceive frames
+#define RIG_ADDR 0x70 // IC-7000, until a request tells the address in use
+
 enum CatState {
-  CAT_FRAME_BEGIN = (FSM_STATE_USERDEF + 1),
-  CAT_ADDRESS,
-  CAT_DATA_END,
+  CAT_WAIT_FRAME = (FSM_STATE_USERDEF + 1),
   CAT_EXEC_CMD,
   CAT_SEND_RESP
 };
 
 #define BUF_SIZE (64)
+#define RXQ_SIZE (64)
+
+#define AUTO_BAUD_BAD_BYTES (8) // garbage bytes before trying the next rate
+
+#define CAT_CMD_COUNT (26) // entries of the command table
+
+// Runs and slowest time of each command, for $7F $01. Costs 4 bytes of RAM
+// per table entry (104 bytes); 0 leaves them out and $7F $01 responds NG.
+#ifndef CAT_CMD_STATS
+#define CAT_CMD_STATS (1)
+#endif
+#define CAT_SUB_ANY (0xFF)
+
+// $1A $00 memory contents: FREQ_A(5) MODE_A FREQ_B(5) MODE_B VFO SPLIT
+#define MEM_CONTENTS_LEN (14)
+
+// An EEPROM block and its CRC, 7 bit packed: 34 bytes -> 39
+#define BLOCK_RAW_LEN (EEPROM_BLOCK_SIZE + 2)
+#define BLOCK_PACKED_LEN (BLOCK_RAW_LEN + (BLOCK_RAW_LEN + 6) / 7)
 
 class CatTask : public FsmTask {
 public:
+  typedef struct {
+    uint8_t cmd;
+    uint8_t sub; // CAT_SUB_ANY matches any subcommand
+    void (CatTask::*handler)();
+  } CatCmd;
+
   virtual void init() {
     _disabled = false;
-
-    Serial.begin(19200, SERIAL_8N1);
-    Serial.flush();
-    this->gotoState(CAT_FRAME_BEGIN);
+    _transceive = false;
+    _rig_changed = false;
+    _rig_addr = RIG_ADDR;
+    _sent_freq = 0;
+    _sent_mode = 0xFF;
+
+    _rxq_head = 0;
+    _rxq_len = 0;
+    _rxq_frames = 0;
+    _rx_len = 0;
+
+#if CAT_CMD_STATS
+    memset(_cmd_hits, 0, sizeof(_cmd_hits));
+    memset(_cmd_max_us, 0, sizeof(_cmd_max_us));
+#endif
+
+    // until the rig settings are loaded
+    setBaud(CAT_BAUD_19200);
+    this->gotoState(CAT_WAIT_FRAME);
   };
 
   virtual bool on_state_change(int8_t new_state, int8_t) {
     switch (new_state) {
-    case CAT_FRAME_BEGIN:
+    case CAT_WAIT_FRAME:
       _buf_pos = 0;
       break;
-    case CAT_EXEC_CMD:
+    case CAT_EXEC_CMD: {
+      uint8_t cmd = _buf[4];
+      int32_t freq = rig.getFreq();
+      uint8_t mode = rig.getMode();
+
       execCmd();
+
+      // The controller knows about its own set freq / set mode, don't echo
+      // them. Anything else changed, or still pending, is sent as usual.
+      if ((cmd == 0x00 || cmd == 0x05) && rig.getFreq() != freq) _sent_freq = rig.getFreq();
+      if ((cmd == 0x01 || cmd == 0x06) && rig.getMode() != mode) _sent_mode = rig.getMode();
       break;
+    }
     case CAT_SEND_RESP:
       _sent_pos = 0;
     default:
@@ -64,15 +117,15 @@ public:
   };
 
   virtual void in_state(int8_t state) {
+    pollSerial();
+
     switch (state) {
-    case CAT_FRAME_BEGIN:
-      readFrameBegin();
-      break;
-    case CAT_ADDRESS:
-      readAddress();
-      break;
-    case CAT_DATA_END:
-      readDataAndEnd();
+    case CAT_WAIT_FRAME:
+      if (popFrame()) {
+        gotoState(CAT_EXEC_CMD);
+      } else if (_rig_changed) {
+        sendTransceive();
+      }
       break;
     case CAT_SEND_RESP:
       sendResp();
@@ -82,68 +135,196 @@ public:
     }
   };
 
+  // Drains the UART into the frame queue. Bytes are kept only from FE FE
+  // to FD, and a frame is seen by the task once it is complete. Also called
+  // from the long LCD and EEPROM paths, so the UART buffer never overflows.
+  void pollSerial() {
+    while (Serial.available() && _rxq_len + _rx_len < RXQ_SIZE) {
+      byte c = Serial.read();
+
+      if (_rx_len < 2 && c != FBC) {
+        // wrong byte
+        _rx_len = 0;
+        if (_auto_baud && (++ _bad_bytes) >= AUTO_BAUD_BAD_BYTES) nextBaud();
+        continue;
+      }
+
+      _rxq[(_rxq_head + _rxq_len + _rx_len) % RXQ_SIZE] = c;
+      _rx_len ++;
+
+      if (c == FEC && _rx_len > 4) {
+        _rxq_len += _rx_len;
+        _rxq_frames ++;
+        _rx_len = 0;
+        _auto_baud = false; // a whole frame, the rate is right
+      } else if (_rx_len == BUF_SIZE) {
+        // frame is too long!
+        _rx_len = 0;
+        if (_auto_baud) nextBaud();
+      }
+    }
+  };
+
   void setDisabled(bool disabled) {
     _disabled = disabled;
   };
 
+  // CAT_BAUD_*. With CAT_BAUD_AUTO the rates are tried in turn until
+  // a complete frame is received.
+  void setBaud(uint8_t baud) {
+    _auto_baud = (baud == CAT_BAUD_AUTO);
+    _baud = _auto_baud ? CAT_BAUD_19200 : baud;
+    _bad_bytes = 0;
+
+    Serial.begin(getBaudRate(_baud), SERIAL_8N1);
+    Serial.flush();
+  };
+
+  // 0 for CAT_BAUD_AUTO
+  static uint32_t getBaudRate(uint8_t baud) {
+    static const uint32_t baud_rates[CAT_BAUD_COUNT] PROGMEM = {
+      19200, 9600, 38400, 57600, 115200, 0
+    };
+
+    return pgm_read_dword(&baud_rates[baud < CAT_BAUD_COUNT ? baud : CAT_BAUD_19200]);
+  };
+
+  // Called by the rig on any freq or mode change
+  void rigChanged() {
+    _rig_changed = true;
+  };
+
 private:
   uint8_t _buf_pos;
   byte _buf[BUF_SIZE * 2]; // for request and for response
   uint8_t _sent_pos;
   bool _disabled;
 
-  void readFrameBegin() {
-    while (Serial.available()) {
-      byte c;
-      Serial.readBytes(&c, 1);
+  byte _rxq[RXQ_SIZE]; // complete frames, one after another
+  uint8_t _rxq_head;
+  uint8_t _rxq_len;
+  uint8_t _rxq_frames;
+  uint8_t _rx_len; // the frame being received, after the queued ones
 
-      if (c != FBC) {
-        // wrong byte
-        gotoState(CAT_FRAME_BEGIN);
-        break;
-      }
+  uint8_t _baud;
+  bool _auto_baud; // still looking for the rate
+  uint8_t _bad_bytes;
 
-      _buf[_buf_pos ++] = c;
+  void nextBaud() {
+    Serial.end();
 
-      if (_buf_pos == 2) {
-        gotoState(CAT_ADDRESS);
-        break;
-      }
-    }
-  };
+    _baud = (_baud + 1) % CAT_BAUD_AUTO;
+    _bad_bytes = 0;
+    _rx_len = 0;
 
-  void readAddress() {
-    while (Serial.available()) {
-      byte c;
-      Serial.readBytes(&c, 1);
+    Serial.begin(getBaudRate(_baud), SERIAL_8N1);
+  };
 
-      _buf[_buf_pos ++] = c;
+#if CAT_CMD_STATS
+  uint16_t _cmd_hits[CAT_CMD_COUNT];
+  uint16_t _cmd_max_us[CAT_CMD_COUNT]; // the slowest run of each command
+#endif
+
+  bool _transceive; // CI-V transceive, set by $1A $05 $00 $92
+  bool _rig_changed;
+  uint8_t _rig_addr;
+  int32_t _sent_freq; // last freq and mode known by the controller
+  uint8_t _sent_mode;
+
+  // Sends an unsolicited $00 (freq) or $01 (mode) frame when the rig has
+  // changed. Only the latest state is sent, so fast tuning does not flood
+  // the line. One frame per pass, the mode follows on the next one.
+  void sendTransceive() {
+    int32_t freq = rig.getFreq();
+    uint8_t mode = rig.getMode();
+
+    if (_disabled || _auto_baud || (!_transceive) || (freq == _sent_freq && mode == _sent_mode)) {
+      _rig_changed = false;
+      return;
+    }
 
-      if (_buf_pos == 4) {
-        gotoState(CAT_DATA_END);
-        break;
-      }
+    _buf[_buf_pos ++] = FBC;
+    _buf[_buf_pos ++] = FBC;
+    _buf[_buf_pos ++] = CTRL_ADDR;
+    _buf[_buf_pos ++] = _rig_addr;
+
+    if (freq != _sent_freq) {
+      _buf[_buf_pos ++] = 0x00;
+      memcpy(&_buf[_buf_pos], rig.getFreqBcd(), FREQ_BCD_LEN);
+      _buf_pos += FREQ_BCD_LEN;
+      _sent_freq = freq;
+    } else {
+      _buf[_buf_pos ++] = 0x01;
+      _buf[_buf_pos ++] = mode;
+      _buf[_buf_pos ++] = FILTER_NORMAL;
+      _sent_mode = mode;
     }
+
+    endResp();
   };
 
-  void readDataAndEnd() {
-    while (Serial.available()) {
-      byte c;
-      Serial.readBytes(&c, 1);
+  // Moves the oldest queued frame into _buf
+  bool popFrame() {
+    if (_rxq_frames == 0) return false;
+
+    byte c;
+    _buf_pos = 0;
+
+    do {
+      c = _rxq[_rxq_head];
+      _rxq_head = (_rxq_head + 1) % RXQ_SIZE;
+      _rxq_len --;
 
       _buf[_buf_pos ++] = c;
+    } while (c != FEC || _buf_pos <= 4);
 
-      if (c == FEC) {
-        gotoState(CAT_EXEC_CMD);
-        break;
-      }
+    _rxq_frames --;
+    _rig_addr = _buf[2];
 
-      if (_buf_pos == BUF_SIZE) {
-        // frame is too long!
-        gotoState(CAT_FRAME_BEGIN);
-        break;
-      }
-    }
+    return true;
+  };
+
+  void noResp() {
+    gotoState(CAT_WAIT_FRAME);
+  };
+
+  // Returns false if idx is out of the table
+  static bool getCmd(uint8_t idx, CatCmd &cmd) {
+    static const CatCmd cmd_table[CAT_CMD_COUNT] PROGMEM = {
+      // cmd  sub           handler
+      { 0x00, CAT_SUB_ANY, &CatTask::noResp         }, // set freq - no resp
+      { 0x01, CAT_SUB_ANY, &CatTask::noResp         }, // set mode - no resp
+      { 0x02, CAT_SUB_ANY, &CatTask::readFreqRange  }, // read lower / upper freq
+      { 0x03, CAT_SUB_ANY, &CatTask::readOpFreq     }, // read operating freq
+      { 0x04, CAT_SUB_ANY, &CatTask::readOpMode     }, // read operating mode
+      { 0x05, CAT_SUB_ANY, &CatTask::setOpFreq      }, // set freq
+      { 0x06, CAT_SUB_ANY, &CatTask::setOpMode      }, // set mode and filter
+      { 0x07, CAT_SUB_ANY, &CatTask::setVfo         }, // select VFO mode or VFO_A/VFO_B
+      { 0x08, CAT_SUB_ANY, &CatTask::setMemory      }, // set memory
+      { 0x09, CAT_SUB_ANY, &CatTask::writeMemory    }, // memory write
+      { 0x0A, CAT_SUB_ANY, &CatTask::memoryToVfo    }, // memory to vfo
+      { 0x0B, CAT_SUB_ANY, &CatTask::clearMemory    }, // memory clear
+      { 0x0F, CAT_SUB_ANY, &CatTask::setSplit       }, // split
+      { 0x14, CAT_SUB_ANY, &CatTask::setLevels      }, // Level settings
+      { 0x15, CAT_SUB_ANY, &CatTask::readLevels     }, // Read Levels and Status
+      { 0x16, CAT_SUB_ANY, &CatTask::setParams      }, // Set Various Parameters
+      { 0x17, CAT_SUB_ANY, &CatTask::sendCw         }, // send CW text
+      { 0x19, CAT_SUB_ANY, &CatTask::getRigId       }, // read rig id
+      { 0x1A, 0x00,        &CatTask::memContents    }, // memory contents
+      { 0x1A, CAT_SUB_ANY, &CatTask::do1aCmd        }, // Various rig spec cmds
+      { 0x1C, CAT_SUB_ANY, &CatTask::transmitOnOff  }, // transmit on / off
+      { 0x7F, 0x01,        &CatTask::readCmdStats   }, // ubitx own: cmd stats
+      { 0x7F, 0x02,        &CatTask::readSnapshot   }, // ubitx own: rig state
+      { 0x7F, 0x03,        &CatTask::readBlock      }, // ubitx own: eeprom block read
+      { 0x7F, 0x04,        &CatTask::writeBlock     }, // ubitx own: eeprom block write
+      { 0x7F, 0xF5,        &CatTask::ubitxCmd       }  // ubitx own: eeprom
+    };
+
+    if (idx >= CAT_CMD_COUNT) return false;
+
+    memcpy_P(&cmd, &cmd_table[idx], sizeof(cmd));
+
+    return true;
   };
 
   void execCmd() {
@@ -152,106 +333,76 @@ private:
       return;
     }
 
-    switch (CMD(_buf[4])) {
-    case 0x00: // set freq - no resp
-      break;
-    case 0x01: // set mode - no resp
-      break;
-    case 0x02: // read lower / upper freq
-      readFreqRange();
-      break;
-    case 0x03: // read operating freq
-      readOpFreq();
-      break;
-    case 0x04: // read operating mode
-      readOpMode();
-      break;
-    case 0x05: // set freq
-      setOpFreq();
-      break;
-    case 0x06: // set mode and filter
-      setOpMode();
-      break;
-    case 0x07: // select VFO mode or VFO_A/VFO_B
-      setVfo();
-      break;
-    case 0x08: // set memory
-      setMemory();
-      break;
-    case 0x09: // memory write
-      writeMemory();
-      break;
-    case 0x0A: // memory to vfo
-      memoryToVfo();
-      break;
-    case 0x0B: // memory clear
-      clearMemory();
-      break;
-    case 0x0F: // split
-      setSplit();
-      break;
-    case 0x14: // Level settings
-      setLevels();
-      break;
-    case 0x15: // Read Levels and Status
-      readLevels();
-      break;
-    case 0x16: // Set Various Parameters
-      setParams();
-      break;
-    case 0x19: // read rig id
-      getRigId();
-      break;
-    case 0x1A: // Various rig spec cmds
-      do1aCmd();
-      break;
-    case 0x1C: // transmit on / off
-      transmitOnOff();
-      break;
-    case 0x7F: // ubitx own command
-      ubitxCmd();
-      break;
-    default:
-      sendNg();
-      break;
+    CatCmd cmd;
+
+    for (uint8_t i = 0; getCmd(i, cmd); i ++) {
+      if (cmd.cmd == _buf[4] && (cmd.sub == CAT_SUB_ANY || cmd.sub == _buf[5])) {
+#if CAT_CMD_STATS
+        uint32_t t = micros();
+
+        (this->*cmd.handler)();
+
+        t = micros() - t;
+        if (_cmd_hits[i] < 0xFFFF) _cmd_hits[i] ++;
+        if (t > _cmd_max_us[i]) _cmd_max_us[i] = t > 0xFFFF ? 0xFFFF : t;
+#else
+        (this->*cmd.handler)();
+#endif
+
+        return;
+      }
     }
+
+    sendNg();
   };
 
-  void sendNg() {
+  // FE FE to fm, then n bytes of the request from the cmd on
+  void beginResp(uint8_t n) {
     _buf[_buf_pos ++] = FBC;
     _buf[_buf_pos ++] = FBC;
     _buf[_buf_pos ++] = _buf[3];
     _buf[_buf_pos ++] = _buf[2];
 
-    _buf[_buf_pos ++] = NGR;
+    for (uint8_t i = 0; i < n; i ++) {
+      _buf[_buf_pos ++] = _buf[4 + i];
+    }
+  };
+
+  void endResp() {
     _buf[_buf_pos ++] = FEC;
 
     gotoState(CAT_SEND_RESP);
   };
 
-  void sendOk() {
-    _buf[_buf_pos ++] = FBC;
-    _buf[_buf_pos ++] = FBC;
-    _buf[_buf_pos ++] = _buf[3];
-    _buf[_buf_pos ++] = _buf[2];
+  void sendNg() {
+    beginResp(0);
+    _buf[_buf_pos ++] = NGR;
+    endResp();
+  };
 
+  void sendOk() {
+    beginResp(0);
     _buf[_buf_pos ++] = OKR;
-    _buf[_buf_pos ++] = FEC;
-
-    gotoState(CAT_SEND_RESP);
+    endResp();
   };
 
+  // Writes only what fits into the UART TX buffer, the rest goes on the
+  // next passes. Never blocks the other tasks.
   void sendResp() {
-    Serial.write(_buf, _buf_pos);
-    gotoState(CAT_FRAME_BEGIN);
+    int n = Serial.availableForWrite();
+
+    if (n > _buf_pos - _sent_pos) n = _buf_pos - _sent_pos;
+
+    if (n > 0) {
+      Serial.write(&_buf[_sent_pos], n);
+      _sent_pos += n;
+    }
+
+    if (_sent_pos == _buf_pos) gotoState(CAT_WAIT_FRAME);
   };
 
   void readFreqRange() {
-    _buf[_buf_pos ++] = FBC;
-    _buf[_buf_pos ++] = FBC;
-    _buf[_buf_pos ++] = _buf[3];
-    _buf[_buf_pos ++] = _buf[2];
-    _buf[_buf_pos ++] = _buf[4];
+    beginResp(1);
 
     // MIN_FREQ - MAX_FREQ
     freq2bcd(MIN_FREQ, &_buf[_buf_pos]);
@@ -262,24 +413,16 @@ private:
     freq2bcd(MAX_FREQ, &_buf[_buf_pos]);
     _buf_pos += 5;
 
-    _buf[_buf_pos ++] = FEC;
-
-    gotoState(CAT_SEND_RESP);
+    endResp();
   };
 
   void readOpFreq() {
-    _buf[_buf_pos ++] = FBC;
-    _buf[_buf_pos ++] = FBC;
-    _buf[_buf_pos ++] = _buf[3];
-    _buf[_buf_pos ++] = _buf[2];
-    _buf[_buf_pos ++] = _buf[4];
-
-    freq2bcd(rig.getFreq(), &_buf[_buf_pos]);
-    _buf_pos += 5;
+    beginResp(1);
 
-    _buf[_buf_pos ++] = FEC;
+    memcpy(&_buf[_buf_pos], rig.getFreqBcd(), FREQ_BCD_LEN);
+    _buf_pos += FREQ_BCD_LEN;
 
-    gotoState(CAT_SEND_RESP);
+    endResp();
   };
 
   void setOpFreq() {
@@ -289,18 +432,13 @@ private:
   };
 
   void readOpMode() {
-    _buf[_buf_pos ++] = FBC;
-    _buf[_buf_pos ++] = FBC;
-    _buf[_buf_pos ++] = _buf[3];
-    _buf[_buf_pos ++] = _buf[2];
-    _buf[_buf_pos ++] = _buf[4];
+    beginResp(1);
 
     // USB - wide filter
     _buf[_buf_pos ++] = rig.getMode();
     _buf[_buf_pos ++] = FILTER_NORMAL;
-    _buf[_buf_pos ++] = FEC;
 
-    gotoState(CAT_SEND_RESP);
+    endResp();
   };
 
   void setOpMode() {
@@ -381,60 +519,34 @@ private:
   };
 
   void setLevels() {
-    bool shouldNg = false;
-
     if (_buf[6] != FEC) {
       // set level, not read. ubitx does not support.
-      shouldNg = true;
+      sendNg();
     } else if (_buf[5] == 0x01 || _buf[5] == 0x02 || _buf[5] == 0x0A || _buf[5] == 0x0B) {
       // AF Level, RF Level, RF Power, MIC Gain - all are 100% (255)
-      _buf[_buf_pos ++] = FBC;
-      _buf[_buf_pos ++] = FBC;
-      _buf[_buf_pos ++] = _buf[3];
-      _buf[_buf_pos ++] = _buf[2];
-      _buf[_buf_pos ++] = _buf[4];
-      _buf[_buf_pos ++] = _buf[5];
+      beginResp(2);
 
       _buf[_buf_pos ++] = 0x02;
       _buf[_buf_pos ++] = 0x55;
 
-      _buf[_buf_pos ++] = FEC;
+      endResp();
     } else {
       // Other level settings are not readable.
-      shouldNg = true;
-    }
-
-    if (shouldNg) {
       sendNg();
-    } else {
-      gotoState(CAT_SEND_RESP);
     }
   };
 
   void readLevels() {
-    bool shouldNg = false;
-
     if (_buf[5] == 0x11) {
       // read rf power meter. ubitx always uses 100% power (255).
-      _buf[_buf_pos ++] = FBC;
-      _buf[_buf_pos ++] = FBC;
-      _buf[_buf_pos ++] = _buf[3];
-      _buf[_buf_pos ++] = _buf[2];
-      _buf[_buf_pos ++] = _buf[4];
-      _buf[_buf_pos ++] = _buf[5];
+      beginResp(2);
 
       _buf[_buf_pos ++] = 0x02;
       _buf[_buf_pos ++] = 0x55;
 
-      _buf[_buf_pos ++] = FEC;
+      endResp();
     } else {
-      shouldNg = true;
-    }
-
-    if (shouldNg) {
       sendNg();
-    } else {
-      gotoState(CAT_SEND_RESP);
     }
   };
 
@@ -450,18 +562,27 @@ private:
     if (isDone) sendOk(); else sendNg();
   };
 
+  void sendCw() {
+    // 05 ...
+    // TEXT FEC - up to 30 chars, or FF to stop sending
+    bool isDone = true;
+
+    if (_buf[5] == 0xFF) {
+      keyerTask.stopText();
+    } else {
+      isDone = _buf_pos > 6 && keyerTask.sendText(&_buf[5], _buf_pos - 6);
+    }
+
+    if (isDone) sendOk(); else sendNg();
+  };
+
   void getRigId() {
-    _buf[_buf_pos ++] = FBC;
-    _buf[_buf_pos ++] = FBC;
-    _buf[_buf_pos ++] = _buf[3];
-    _buf[_buf_pos ++] = _buf[2];
-    _buf[_buf_pos ++] = _buf[4];
+    beginResp(1);
 
     // returns the address in the request
     _buf[_buf_pos ++] = _buf[2];
-    _buf[_buf_pos ++] = FEC;
 
-    gotoState(CAT_SEND_RESP);
+    endResp();
   };
 
   void transmitOnOff() {
@@ -470,17 +591,11 @@ private:
         rig.setTx(_buf[6]);
         sendOk();
       } else { // Read
-        _buf[_buf_pos ++] = FBC;
-        _buf[_buf_pos ++] = FBC;
-        _buf[_buf_pos ++] = _buf[3];
-        _buf[_buf_pos ++] = _buf[2];
-        _buf[_buf_pos ++] = _buf[4];
-        _buf[_buf_pos ++] = _buf[5];
+        beginResp(2);
 
         _buf[_buf_pos ++] = rig.getTx();
-        _buf[_buf_pos ++] = FEC;
 
-        gotoState(CAT_SEND_RESP);
+        endResp();
       }
     } else  {
       sendNg();
@@ -488,27 +603,90 @@ private:
   };
 
   void do1aCmd() {
-    if (_buf[5] == 0x05 && _buf[6] == 0x00 && _buf[7] == 0x92 && _buf[8] == 0x00) {
-      // 1A 05 00 92 00- OmniRig init command. It expects OK.
-      sendOk();
+    if (_buf[5] == 0x05 && _buf[6] == 0x00 && _buf[7] == 0x92) {
+      // 1A 05 00 92 - CI-V transceive. OmniRig sets it OFF on init.
+      if (_buf[8] == 0x00 || _buf[8] == 0x01) {
+        _transceive = _buf[8];
+        sendOk();
+      } else if (_buf[8] == FEC) {
+        beginResp(4);
+
+        _buf[_buf_pos ++] = _transceive ? 0x01 : 0x00;
+
+        endResp();
+      } else {
+        sendNg();
+      }
     } else if (_buf[5] == 0x03 && _buf[6] == FEC) {
       // IF Filter width
-      _buf[_buf_pos ++] = FBC;
-      _buf[_buf_pos ++] = FBC;
-      _buf[_buf_pos ++] = _buf[3];
-      _buf[_buf_pos ++] = _buf[2];
-      _buf[_buf_pos ++] = _buf[4];
-      _buf[_buf_pos ++] = _buf[5];
+      beginResp(2);
 
       _buf[_buf_pos ++] = 0x31; // 2.7KHz
-      _buf[_buf_pos ++] = FEC;
 
-      gotoState(CAT_SEND_RESP);
+      endResp();
     } else {
       sendNg();
     }
   };
 
+  void memContents() {
+    // 05 06 07 08
+    // 00 00 CH FEC                   - read, CH in BCD
+    // 00 00 CH {MEM_CONTENTS} FEC    - write
+    // 00 00 CH FF FEC                - clear
+    // resp of read: 00 00 CH {MEM_CONTENTS} or FF for an empty channel
+    Channel ch;
+    uint8_t ch_idx = (_buf[7] >> 4) * 10 + (_buf[7] & 0x0F);
+    bool isDone = false;
+
+    if (_buf[6] != 0x00 || ch_idx >= MEM_SIZE) {
+      // more than 99, or no such channel
+    } else if (_buf_pos == 9 && _buf[8] == FEC) { // read
+      beginResp(4);
+
+      if (rig.readMemCh(ch_idx, ch)) {
+        for (uint8_t v = VFO_A; v <= VFO_B; v ++) {
+          freq2bcd(ch.vfos[v].freq, &_buf[_buf_pos]);
+          _buf_pos += FREQ_BCD_LEN;
+          _buf[_buf_pos ++] = ch.vfos[v].mode;
+        }
+
+        _buf[_buf_pos ++] = ch.active_vfo;
+        _buf[_buf_pos ++] = ch.split;
+      } else {
+        _buf[_buf_pos ++] = 0xFF;
+      }
+
+      endResp();
+      return;
+    } else if (_buf_pos == 10 && _buf[8] == 0xFF) { // clear
+      isDone = rig.writeMemCh(ch_idx, NULL);
+    } else if (_buf_pos == 9 + MEM_CONTENTS_LEN) { // write
+      const byte *p = &_buf[8];
+
+      isDone = true;
+
+      for (uint8_t v = VFO_A; v <= VFO_B; v ++) {
+        ch.vfos[v].freq = bcd2freq(p);
+        p += FREQ_BCD_LEN;
+        ch.vfos[v].mode = *p ++;
+
+        if (ch.vfos[v].freq < MIN_FREQ || ch.vfos[v].freq > MAX_FREQ) isDone = false;
+        if (ch.vfos[v].mode != MODE_LSB && ch.vfos[v].mode != MODE_USB
+          && ch.vfos[v].mode != MODE_CW && ch.vfos[v].mode != MODE_CWR) isDone = false;
+      }
+
+      ch.active_vfo = *p ++;
+      ch.split = *p ++;
+
+      if (ch.active_vfo > VFO_B || ch.split > ON) isDone = false;
+
+      if (isDone) isDone = rig.writeMemCh(ch_idx, &ch);
+    }
+
+    if (isDone) sendOk(); else sendNg();
+  };
+
   void ubitxCmd() {
     // 05 06 07      08      09             10 + LEN * 3
     // F5 05 ADDR_HI ADDR_LO LEN {CONTENTS} FEC
@@ -527,22 +705,11 @@ private:
 
       if (isRead) { // read eeprom
         if (rig.readEepromBcd(addr, len, _buf + 21)) {
-          _buf[_buf_pos ++] = FBC;
-          _buf[_buf_pos ++] = FBC;
-          _buf[_buf_pos ++] = _buf[3];
-          _buf[_buf_pos ++] = _buf[2];
-          _buf[_buf_pos ++] = _buf[4];
-          _buf[_buf_pos ++] = _buf[5];
-          _buf[_buf_pos ++] = _buf[6];
-          _buf[_buf_pos ++] = _buf[7];
-          _buf[_buf_pos ++] = _buf[8];
-          _buf[_buf_pos ++] = _buf[9];
+          beginResp(6);
 
           _buf_pos += (len * 2);
 
-          _buf[_buf_pos ++] = FEC;
-
-          gotoState(CAT_SEND_RESP);
+          endResp();
         } else {
           sendNg();
         }
@@ -556,31 +723,150 @@ private:
     } else {
       sendNg();
     }
-  }
+  };
+
+  void readSnapshot() {
+    // 05 06
+    // 02 FEC
+    // resp: 02 FREQ_A(5) MODE_A FREQ_B(5) MODE_B VFO SPLIT TX MEM CH LOCK FEC
+    // MEM is 00 in VFO mode, CH is in BCD
+    if (_buf[6] != FEC) {
+      sendNg();
+      return;
+    }
+
+    beginResp(2);
+
+    for (uint8_t v = VFO_A; v <= VFO_B; v ++) {
+      freq2bcd(rig.getVfoFreq(v), &_buf[_buf_pos]);
+      _buf_pos += FREQ_BCD_LEN;
+      _buf[_buf_pos ++] = rig.getVfoMode(v);
+    }
+
+    _buf[_buf_pos ++] = rig.getVfo();
+    _buf[_buf_pos ++] = rig.getSplit();
+    _buf[_buf_pos ++] = rig.getTx();
+    _buf[_buf_pos ++] = rig.isVfo() ? 0x00 : 0x01;
+    num2bcd(rig.getMemCh(), &_buf[_buf_pos ++], 1);
+    _buf[_buf_pos ++] = rig.getDialLock();
+
+    endResp();
+  };
+
+  // Every 7 bytes go as 8: first the bit 7 of each of them, bit 0 for the
+  // first byte, then the 7 bytes with bit 7 cleared. So no byte of the
+  // packed data is FE or FD.
+  static uint8_t pack7(const uint8_t *src, uint8_t len, uint8_t *dst) {
+    uint8_t n = 0;
+
+    for (uint8_t i = 0; i < len; i += 7) {
+      uint8_t *msb = &dst[n ++];
+      *msb = 0;
+
+      for (uint8_t j = 0; j < 7 && i + j < len; j ++) {
+        *msb |= (src[i + j] >> 7) << j;
+        dst[n ++] = src[i + j] & 0x7F;
+      }
+    }
+
+    return n;
+  };
+
+  // Returns the unpacked length, 0 if there is a byte with bit 7 set
+  static uint8_t unpack7(const uint8_t *src, uint8_t len, uint8_t *dst) {
+    uint8_t n = 0;
+
+    for (uint8_t i = 0; i < len; i += 8) {
+      uint8_t msb = src[i];
+      if (msb & 0x80) return 0;
+
+      for (uint8_t j = 1; j < 8 && i + j < len; j ++) {
+        if (src[i + j] & 0x80) return 0;
+        dst[n ++] = src[i + j] | (((msb >> (j - 1)) & 0x01) << 7);
+      }
+    }
+
+    return n;
+  };
+
+  // CRC-16/CCITT-FALSE of the block number and the data
+  static uint16_t blockCrc(uint8_t blk, const uint8_t *data) {
+    uint16_t crc = 0xFFFF;
 
-  void freq2bcd(int32_t freq, byte *bcd) {
-    uint8_t lo, hi;
-    for (int8_t i = 0; i < 5; i ++) {
-      lo = freq % 10;
-      freq /= 10;
-      hi = freq % 10;
-      freq /= 10;
+    for (int8_t i = -1; i < EEPROM_BLOCK_SIZE; i ++) {
+      crc ^= (uint16_t)(i < 0 ? blk : data[i]) << 8;
 
-      bcd[i] = (hi << 4) + lo;
+      for (uint8_t b = 0; b < 8; b ++) {
+        crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+      }
     }
+
+    return crc;
   };
 
-  int32_t bcd2freq(const byte *bcd) {
-    int32_t ret_val = 0;
-    uint8_t lo, hi;
-    for (int8_t i = 4; i >= 0; i --) {
-      lo = bcd[i] & 0x0F;
-      hi = (bcd[i] >> 4) & 0x0F;
+  void readBlock() {
+    // 05 06  07
+    // 03 BLK FEC - BLK: 0 to 31, 32 bytes each
+    // resp: 03 BLK {DATA(32) CRC_HI CRC_LO}, 7 bit packed
+    uint8_t raw[BLOCK_RAW_LEN];
 
-      ret_val = ret_val * 100 + hi * 10 + lo;
+    if (_buf[7] == FEC && rig.readEepromBlock(_buf[6], raw)) {
+      uint16_t crc = blockCrc(_buf[6], raw);
+      raw[EEPROM_BLOCK_SIZE] = crc >> 8;
+      raw[EEPROM_BLOCK_SIZE + 1] = crc & 0xFF;
+
+      beginResp(3);
+
+      _buf_pos += pack7(raw, BLOCK_RAW_LEN, &_buf[_buf_pos]);
+
+      endResp();
+    } else {
+      sendNg();
     }
+  };
+
+  void writeBlock() {
+    // 05 06  07 ... 45                               46
+    // 04 BLK {DATA(32) CRC_HI CRC_LO}, 7 bit packed  FEC
+    uint8_t raw[BLOCK_RAW_LEN];
 
-    return ret_val;
+    if (_buf_pos == 8 + BLOCK_PACKED_LEN && _buf[7 + BLOCK_PACKED_LEN] == FEC
+      && unpack7(&_buf[7], BLOCK_PACKED_LEN, raw) == BLOCK_RAW_LEN
+      && blockCrc(_buf[6], raw) == ((raw[EEPROM_BLOCK_SIZE] << 8) | raw[EEPROM_BLOCK_SIZE + 1])
+      && rig.writeEepromBlock(_buf[6], raw)) {
+      sendOk();
+    } else {
+      sendNg();
+    }
+  };
+
+  void readCmdStats() {
+    // 05 06  07
+    // 01 IDX FEC - IDX in BCD, the index in the command table
+    // resp: 01 IDX CMD SUB HITS(3) MAX_US(3) FEC, HITS and MAX_US in BCD
+#if CAT_CMD_STATS
+    CatCmd cmd;
+    uint8_t idx = (_buf[6] >> 4) * 10 + (_buf[6] & 0x0F);
+
+    if (_buf[7] == FEC && getCmd(idx, cmd)) {
+      beginResp(3);
+
+      _buf[_buf_pos ++] = cmd.cmd;
+      _buf[_buf_pos ++] = cmd.sub;
+
+      num2bcd(_cmd_hits[idx], &_buf[_buf_pos], 3);
+      _buf_pos += 3;
+
+      num2bcd(_cmd_max_us[idx], &_buf[_buf_pos], 3);
+      _buf_pos += 3;
+
+      endResp();
+    } else {
+      sendNg();
+    }
+#else
+    sendNg();
+#endif
   };
 };
 
@@ -0,0 +1,169 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <Arduino.h>
+#include "cw_timer.h"
+#include "rig.h"
+
+typedef struct {
+  uint8_t flags;
+  uint16_t on_ms;
+  uint16_t off_ms;
+} CwElement;
+
+static CwElement cw_queue[CW_TIMER_QUEUE_SIZE];
+static volatile uint8_t cw_queue_head = 0;
+static volatile uint8_t cw_queue_len = 0;
+
+// The running element
+static volatile uint8_t cw_flags = 0; // what is applied to the pins
+static volatile bool cw_on = false;
+static volatile uint16_t cw_remaining = 0; // ms left of the on or off part
+
+static uint8_t cw_tone_state = OFF; // the sidetone as last set by cw_timer_poll()
+
+// The key pin only, the sidetone is left to cw_timer_poll()
+static void cw_apply(uint8_t flags) {
+  if ((flags ^ cw_flags) & CW_ELEMENT_KEY) {
+    if (flags & CW_ELEMENT_KEY) Device::cwKeyDown(); else Device::cwKeyUp();
+  }
+
+  cw_flags = flags;
+}
+
+static void cw_update_tone() {
+  uint8_t t = (cw_flags & CW_ELEMENT_TONE) ? ON : OFF;
+
+  if (t != cw_tone_state) {
+    cw_tone_state = t;
+    Device::cwTone(t);
+  }
+}
+
+// Every 1 ms
+static void cw_timer_tick() {
+  if (cw_remaining > 0 && (-- cw_remaining) > 0) return;
+
+  if (cw_on) {
+    // the off part
+    cw_on = false;
+    cw_apply(0);
+    cw_remaining = cw_queue[cw_queue_head].off_ms;
+
+    cw_queue_head = (cw_queue_head + 1) % CW_TIMER_QUEUE_SIZE;
+    cw_queue_len --;
+
+    if (cw_remaining > 0) return;
+  }
+
+  if (cw_queue_len > 0) {
+    // next element, it stays in the queue until its off part
+    cw_on = true;
+    cw_apply(cw_queue[cw_queue_head].flags);
+    cw_remaining = cw_queue[cw_queue_head].on_ms;
+  }
+}
+
+#ifdef __AVR__
+
+ISR(TIMER1_COMPA_vect) {
+  cw_timer_tick();
+}
+
+void cw_timer_init() {
+  noInterrupts();
+
+  // CTC, clk/64, 1 ms
+  TCCR1A = 0;
+  TCCR1B = _BV(WGM12) | _BV(CS11) | _BV(CS10);
+  TCNT1 = 0;
+  OCR1A = F_CPU / 64 / 1000 - 1;
+  TIMSK1 |= _BV(OCIE1A);
+
+  interrupts();
+}
+
+void cw_timer_poll() {
+  cw_update_tone();
+}
+
+#else
+
+static unsigned long cw_ticked_at = 0;
+
+void cw_timer_init() {
+  cw_ticked_at = millis();
+}
+
+void cw_timer_poll() {
+  while (cw_ticked_at != millis()) {
+    cw_ticked_at ++;
+    cw_timer_tick();
+  }
+
+  cw_update_tone();
+}
+
+#endif
+
+bool cw_timer_send(uint8_t flags, uint16_t on_ms, uint16_t off_ms) {
+  bool result = false;
+
+  noInterrupts();
+
+  if (cw_queue_len < CW_TIMER_QUEUE_SIZE) {
+    CwElement &e = cw_queue[(cw_queue_head + cw_queue_len) % CW_TIMER_QUEUE_SIZE];
+    e.flags = flags;
+    e.on_ms = on_ms;
+    e.off_ms = off_ms;
+    cw_queue_len ++;
+
+    result = true;
+  }
+
+  interrupts();
+
+  return result;
+}
+
+uint8_t cw_timer_free() {
+  return CW_TIMER_QUEUE_SIZE - cw_queue_len;
+}
+
+void cw_timer_clear() {
+  noInterrupts();
+
+  cw_queue_len = 0;
+  cw_on = false;
+  cw_remaining = 0;
+  cw_apply(0);
+
+  interrupts();
+
+  cw_update_tone();
+}
+
+// An element leaves the queue when its off part starts
+bool cw_timer_keying() {
+  return cw_queue_len > 0;
+}
+
+bool cw_timer_busy() {
+  noInterrupts();
+  bool result = (cw_queue_len > 0) || cw_remaining > 0;
+  interrupts();
+
+  return result;
+}
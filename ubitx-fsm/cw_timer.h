@@ -0,0 +1,47 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __CW_TIMER_H__
+#define __CW_TIMER_H__
+
+#include <stdint.h>
+
+// Keys the CW elements at exact 1 ms boundaries. On AVR the elements are
+// run by the Timer1 compare interrupt, so the time taken by the other tasks
+// does not change their length or the gaps. The keyer queues them ahead.
+// Elsewhere cw_timer_poll() runs them from the loop.
+// tone() is not safe in an interrupt, the sidetone follows the elements
+// from cw_timer_poll(), which must be called often.
+
+#define CW_ELEMENT_TONE (0x01) // sidetone during the element
+#define CW_ELEMENT_KEY (0x02) // CW_KEY down during the element
+
+#define CW_TIMER_QUEUE_SIZE (8) // a whole char, 7 elements at most
+
+void cw_timer_init();
+void cw_timer_poll();
+
+// An element: on_ms with the flags, then off_ms of silence.
+// False if the queue is full.
+bool cw_timer_send(uint8_t flags, uint16_t on_ms, uint16_t off_ms);
+uint8_t cw_timer_free(); // room left in the queue
+
+// Drops the queued elements and keys up right now
+void cw_timer_clear();
+
+bool cw_timer_keying(); // an element is queued or in its on part
+bool cw_timer_busy(); // an element is queued or running, gap included
+
+#endif // __CW_TIMER_H__
@@ -16,6 +16,7 @@
 #include "display_task.h"
 #include "rig.h"
 #include "objs.h"
+#include "cat_task.h"
 
 #include <LiquidCrystal.h>
 LiquidCrystal lcd(8, 9, 10, 11, 12, 13);
@@ -72,8 +73,6 @@ const PROGMEM uint8_t cust_char_table[] = {
 
 const uint8_t cust_char_table_len = sizeof(cust_char_table) / sizeof(cust_char_table[0]);
 
-#define UPDATE_DISPLAY (FSM_STATE_USERDEF + 1)
-
 void DisplayTask::init() {
   lcd.begin(16, 2);
 
@@ -98,6 +97,8 @@ bool DisplayTask::on_state_change(int8_t new_state, int8_t) {
           _printed[row][col] = _buf[row][col];
         }
       }
+
+      catTask.pollSerial();
     }
 
     delay(20, UPDATE_DISPLAY);
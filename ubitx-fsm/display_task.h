@@ -18,6 +18,8 @@
 
 #include <fsmos.h>
 
+#define UPDATE_DISPLAY (FSM_STATE_USERDEF + 1)
+
 class DisplayTask : public FsmTask {
 public:
   DisplayTask() {
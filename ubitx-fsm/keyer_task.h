@@ -21,6 +21,8 @@
 #include "rig.h"
 #include "ui_tasks.h"
 #include "objs.h"
+#include "cw_timer.h"
+#include "adc_sampler.h"
 
 // char buffer - FIFO
 class CharBuffer {
@@ -71,6 +73,10 @@ public:
   void clear() {
     _size = 0;
   };
+
+  uint8_t size() {
+    return _size;
+  };
 private:
   uint8_t _capacity;
   uint8_t _head_idx;
@@ -95,18 +101,20 @@ private:
 
 #define SS_IDLE (0)
 #define SS_CH (1)
-#define SS_ICG (2)
-#define SS_IWG (3)
+#define SS_END (2)
+
+#define TX_BUFFER_SIZE (32) // text from CAT, waiting to be sent
 
 class KeyerTask : public FsmTask {
 public:
-  KeyerTask(uint8_t pin) : _char_buffer(4) {
+  KeyerTask(uint8_t pin) : _char_buffer(4), _tx_buffer(TX_BUFFER_SIZE) {
     _pin = pin;
     _is_key_down = false;
     _key_up_at = 0;
     _cw_delay_enabled = false;
 
     _autotext_mode = false;
+    _text_from_cat = false;
 
     _element_at = 0;
     _element_type = ET_IDLE;
@@ -120,6 +128,9 @@ public:
 
   virtual void init() {
     pinMode(_pin, INPUT_PULLUP);
+    _adc_slot = adc_sampler_add(_pin);
+
+    cw_timer_init();
 
     gotoState(KEY_READY);
   };
@@ -127,7 +138,8 @@ public:
   virtual bool on_state_change(int8_t new_state, int8_t) {
     _autotext_mode = (new_state == KEY_AUTOTEXT);
 
-    if (_is_key_down) keyUp();
+    // also drops the elements still queued
+    if (_is_key_down || cw_timer_busy()) keyUp();
 
     switch (new_state) {
     case KEY_READY:
@@ -148,6 +160,8 @@ public:
   };
 
   virtual void in_state(int8_t state) {
+    cw_timer_poll();
+
     if (_disabled) return;
 
     if (rig.getTxMode() != MODE_CW && rig.getTxMode() != MODE_CWR && !uiTask.isMenuMode()) return;
@@ -178,16 +192,43 @@ public:
     if (atm) {
       uint8_t mode = rig.getTxMode();
       if ((mode == MODE_CW || mode == MODE_CWR) && (!_autotext_mode)) {
+        _text_from_cat = false;
         gotoState(KEY_AUTOTEXT);
         result = true;
       }
     } else {
+      _tx_buffer.clear();
       gotoState(KEY_READY);
     }
 
     return result;
   };
 
+  // Queues text from CAT ($17), sent the same way as the autokey text.
+  // False if not in CW, the autokey text is being sent, or no room.
+  bool sendText(const uint8_t *text, uint8_t len) {
+    uint8_t mode = rig.getTxMode();
+
+    if (_disabled || (mode != MODE_CW && mode != MODE_CWR)) return false;
+    if (_autotext_mode && (!_text_from_cat)) return false;
+    if (_tx_buffer.size() + len > TX_BUFFER_SIZE) return false;
+
+    for (uint8_t i = 0; i < len; i ++) {
+      _tx_buffer.push(text[i]);
+    }
+
+    if (!_autotext_mode) {
+      _text_from_cat = true;
+      gotoState(KEY_AUTOTEXT);
+    }
+
+    return true;
+  };
+
+  void stopText() {
+    if (_autotext_mode && _text_from_cat) setAutoTextMode(false);
+  };
+
   bool getChar(char &ch) {
     return _char_buffer.pop(ch);
   };
@@ -195,15 +236,22 @@ public:
   void clearChar() {
     _char_buffer.clear();
   };
+
+#ifdef UBITX_BENCH
+  friend class Bench;
+#endif
 private:
   uint8_t _pin;
+  int8_t _adc_slot;
   bool _disabled;
   bool _autotext_mode;
+  bool _text_from_cat;
 
   CharBuffer _char_buffer;
+  CharBuffer _tx_buffer;
 
   uint8_t getPaddle() {
-    int paddle = analogRead(_pin);
+    int paddle = adc_sampler_get(_adc_slot);
 
     if (paddle > 800) return PADDLE_NONE;
     if (paddle > 600) return PADDLE_DASH;
@@ -232,7 +280,52 @@ private:
     Device::cwKeyDown();
   };
 
+  // Turns TX on for the elements about to be queued, and returns their flags
+  uint8_t startKeying() {
+    uint8_t flags = CW_ELEMENT_TONE;
+
+    uint8_t mode = rig.getTxMode();
+    if ((!uiTask.isMenuMode()) && (mode == MODE_CW || mode == MODE_CWR)) {
+      if (rig.getTx() != ON) {
+        rig.setTx(ON);
+      }
+
+      _is_key_down = true;
+      _cw_delay_enabled = true;
+      flags |= CW_ELEMENT_KEY;
+    }
+
+    return flags;
+  };
+
+  // Queues a dot or a dash and the gap after it. The element is keyed
+  // by cw_timer, in_ready_state() only follows it.
+  void sendElement(uint16_t on_ms, uint16_t off_ms) {
+    cw_timer_send(startKeying(), on_ms, off_ms);
+  };
+
+  // Elements of a morse_table code, up to its end bit
+  static uint8_t morseLength(uint8_t m) {
+    uint8_t n = 0;
+
+    for (; (m & 0x7F) != 0; m <<= 1) n ++;
+
+    return n;
+  };
+
+  // Queues a whole char, and the char gap after its last element
+  void sendChar(uint8_t m) {
+    uint16_t cwSpeed = Device::getCwSpeed();
+    uint8_t flags = startKeying();
+
+    for (; (m & 0x7F) != 0; m <<= 1) {
+      bool last = ((m << 1) & 0x7F) == 0;
+      cw_timer_send(flags, m & 0x80 ? cwSpeed * 3 : cwSpeed, last ? cwSpeed * 3 : cwSpeed);
+    }
+  };
+
   void keyUp() {
+    cw_timer_clear();
     Device::cwTone(OFF);
 
     _is_key_down = false;
@@ -249,17 +342,52 @@ private:
   uint8_t _element_type;
   uint8_t _expect_key, _next_key;
 
-  void in_ready_state(uint8_t paddle_key = PADDLE_NONE) {
-    uint8_t cwKey = Device::getCwKey();
-    uint8_t k = getPaddle();
+  // Picks the next element from the paddle, and queues it
+  bool startElement(uint8_t k, uint8_t cwKey, uint16_t cwSpeed) {
+    if (cwKey == CW_KEY_IAMBIC_B_L || cwKey == CW_KEY_IAMBIC_B_R) {
+      // Iambic B
+      if (_next_key != PADDLE_NONE) {
+        k = _next_key;
+      }
+    }
+
+    _next_key = PADDLE_NONE;
 
-    if (paddle_key != PADDLE_NONE) {
-      // simulate paddle
-      cwKey = CW_KEY_IAMBIC_A_R;
-      _next_key = PADDLE_NONE;
-      k = paddle_key;
+    if (k == PADDLE_BOTH) {
+      if (_expect_key != PADDLE_NONE) {
+        k = _expect_key;
+      } else {
+        k = PADDLE_DASH; // Dash first
+      }
+      _next_key = k == PADDLE_DASH ? PADDLE_DOT : PADDLE_DASH;
     }
 
+    if (k == PADDLE_DASH) {
+      _expect_key = PADDLE_DOT;
+      _element_type = ET_DASH;
+      _element_at = millis();
+      sendElement(cwSpeed * 3, cwSpeed);
+
+      _receiving_m = (_receiving_m << 1) | 0x01;
+    } else if (k == PADDLE_DOT) {
+      _expect_key = PADDLE_DASH;
+      _element_type = ET_DOT;
+      _element_at = millis();
+      sendElement(cwSpeed, cwSpeed);
+
+      _receiving_m = _receiving_m << 1;
+    } else {
+      _expect_key = PADDLE_NONE;
+      return false;
+    }
+
+    return true;
+  };
+
+  void in_ready_state() {
+    uint8_t cwKey = Device::getCwKey();
+    uint8_t k = getPaddle();
+
     if (cwKey== CW_KEY_STRAIGHT) {
       if (!_is_key_down) {
         if (k == PADDLE_DOT || k == PADDLE_BOTH || k == PADDLE_STRAIGHT) {
@@ -281,41 +409,7 @@ private:
 
       switch (_element_type) {
       case ET_IDLE:
-        if (cwKey == CW_KEY_IAMBIC_B_L || cwKey == CW_KEY_IAMBIC_B_R) {
-          // Iambic B
-          if (_next_key != PADDLE_NONE) {
-            k = _next_key;
-          }
-        }
-
-        _next_key = PADDLE_NONE;
-
-        if (k == PADDLE_BOTH) {
-          if (_expect_key != PADDLE_NONE) {
-            k = _expect_key;
-          } else {
-            k = PADDLE_DASH; // Dash first
-          }
-          _next_key = k == PADDLE_DASH ? PADDLE_DOT : PADDLE_DASH;
-        }
-
-        if (k == PADDLE_DASH) {
-          _expect_key = PADDLE_DOT;
-          _element_type = ET_DASH;
-          _element_at = millis();
-          keyDown();
-
-          _receiving_m = (_receiving_m << 1) | 0x01;
-        } else if (k == PADDLE_DOT) {
-          _expect_key = PADDLE_DASH;
-          _element_type = ET_DOT;
-          _element_at = millis();
-          keyDown();
-
-          _receiving_m = _receiving_m << 1;
-        } else {
-          _expect_key = PADDLE_NONE;
-
+        if (!startElement(k, cwKey, cwSpeed)) {
           if ((_receiving_m != 0x01)
             && (millis() - _element_at > (cwSpeed * 2))) {
             if ((_receiving_m & 0x80) != 0) { // may be '$'
@@ -338,24 +432,27 @@ private:
         }
         break;
       case ET_DOT:
-        if (k == PADDLE_BOTH || k == _expect_key) _next_key = _expect_key;
-        if (millis() - _element_at >= cwSpeed) {
-          _element_type = ET_IG;
-          _element_at = millis();
-          keyUp();
-        }
-        break;
       case ET_DASH:
         if (k == PADDLE_BOTH || k == _expect_key) _next_key = _expect_key;
-        if (millis() - _element_at >= cwSpeed * 3) {
-          _element_type = ET_IG;
-          _element_at = millis();
-          keyUp();
+        if (!cw_timer_keying()) {
+          // cw_timer has keyed up. Iambic B sends the element latched
+          // during this one whatever the paddle does in the gap, so it is
+          // queued now and starts right when the gap ends. Otherwise the
+          // paddle is read at the end of the gap.
+          _is_key_down = false;
+          _key_up_at = millis();
+
+          bool iambicB = cwKey == CW_KEY_IAMBIC_B_L || cwKey == CW_KEY_IAMBIC_B_R;
+
+          if (!(iambicB && _next_key != PADDLE_NONE && startElement(k, cwKey, cwSpeed))) {
+            _element_type = ET_IG;
+            _element_at = _key_up_at;
+          }
         }
         break;
       case ET_IG:
         if (k == PADDLE_BOTH || k == _expect_key) _next_key = _expect_key;
-        if (millis() - _element_at >= cwSpeed) {
+        if (!cw_timer_busy()) {
           _element_type = ET_IDLE;
         }
         break;
@@ -382,58 +479,57 @@ private:
     }
 
     if (getPaddle() != PADDLE_NONE) {
-      if (_is_key_down) keyUp();
+      if (_is_key_down || cw_timer_busy()) keyUp();
 
       _wait_paddle_release = true;
       return;
     }
 
+    if (_is_key_down && !cw_timer_keying()) {
+      _is_key_down = false;
+      _key_up_at = millis();
+    }
+
     char ch;
 
+    // The chars are queued whole, with their gaps, while the one before
+    // is still being sent, so cw_timer runs the text without a break.
     switch (_sending_state) {
     case SS_IDLE:
-      rig.getAutokeyTextCh(_sending_ch_idx, ch);
-      _sending_ch_idx ++;
+      if (_text_from_cat) {
+        if (!_tx_buffer.pop(ch)) ch = 0;
+      } else {
+        rig.getAutokeyTextCh(_sending_ch_idx, ch);
+        _sending_ch_idx ++;
+      }
 
       if (ch == 0) {
         // end of the text
         _sending_ch_idx = 0;
-        setAutoTextMode(false);
+        _sending_state = SS_END;
       } else {
         _sending_m = get_or_compare_morse(ch);
-
-        if (_sending_m == 0x80) {
-          // unknown char, or space
-          _element_at = millis();
-          _sending_state = SS_IWG;
-        } else {
-          _element_type = ET_IDLE;
-          _sending_state = SS_CH;
-        }
+        _sending_state = SS_CH;
       }
       break;
     case SS_CH:
       if (_sending_m == 0x80) {
-        // finished char!
-        _element_at = millis();
-        _sending_state = SS_ICG;
-      } else {
-        in_ready_state(_sending_m & 0x80 ? PADDLE_DASH : PADDLE_DOT);
-
-        if (_element_type == ET_IDLE) {
-          // finished dot/dash
-          _sending_m <<= 1;
+        // unknown char, or space: the word gap, 7 with the char gap
+        if (cw_timer_free() > 0) {
+          cw_timer_send(0, Device::getCwSpeed() * 4, 0);
+          _sending_state = SS_IDLE;
         }
-      }
-      break;
-    case SS_ICG:
-      if (millis() - _element_at >= Device::getCwSpeed() * 2) {
+      } else if (cw_timer_free() >= morseLength(_sending_m)) {
+        sendChar(_sending_m);
         _sending_state = SS_IDLE;
       }
       break;
-    case SS_IWG:
-      if (millis() - _element_at >= Device::getCwSpeed() * 4) {
+    case SS_END:
+      if (_text_from_cat && _tx_buffer.size() > 0) {
+        // more text came in meanwhile
         _sending_state = SS_IDLE;
+      } else if (!cw_timer_busy()) {
+        setAutoTextMode(false);
       }
       break;
     default:
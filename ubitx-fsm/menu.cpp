@@ -473,6 +473,49 @@ void format_menu_value_bfo(char *buf, int16_t val) {
   }
 }
 
+bool select_menu_i2c(int16_t val, bool selected) {
+  if (!selected) return false;
+
+  Device::setI2cFast(val == 1 ? ON : OFF);
+
+  return false;
+}
+
+int16_t get_menu_value_i2c() {
+  return Device::getI2cFast() == ON ? 1 : 0;
+}
+
+void format_menu_value_i2c(char *buf, int16_t val) {
+  char msg[17];
+
+  strcpy_P(buf, val == 1 ? PSTR("400kHz") : PSTR("100kHz"));
+
+  // bus time of the last and the slowest Si5351 update
+  sprintf(msg, "%5" PRIu16 "us/%5" PRIu16 "us", si5351bx_commit_us, si5351bx_commit_us_max);
+  displayTask.clear1();
+  displayTask.print1(msg);
+}
+
+bool select_menu_cat_baud(int16_t val, bool selected) {
+  if (!selected) return false;
+
+  Device::setCatBaud(val);
+
+  return false;
+}
+
+int16_t get_menu_value_cat_baud() {
+  return Device::getCatBaud();
+}
+
+void format_menu_value_cat_baud(char *buf, int16_t val) {
+  if (val == CAT_BAUD_AUTO) {
+    strcpy_P(buf, PSTR("Auto"));
+  } else {
+    sprintf(buf, "%" PRIu32, CatTask::getBaudRate(val));
+  }
+}
+
 bool select_menu_sys_conf(int16_t val, bool selected) {
   if (!selected) return false;
 
@@ -525,6 +568,8 @@ const Menu_Item system_menu[] PROGMEM = {
   {"10MHz Cal",    -1, select_menu_10m,      format_menu_10m,    get_menu_value_10m,      format_menu_value_10m,      NULL},
   {"0BEAT Cal",    -1, select_menu_0beat,    format_menu_0beat,  get_menu_value_0beat,    format_menu_value_0beat,    NULL},
   {"BFO Cal",      -1, select_menu_bfo,      format_menu_bfo,    get_menu_value_bfo,      format_menu_value_bfo,      NULL},
+  {"I2C",           2, select_menu_i2c,      NULL,               get_menu_value_i2c,      format_menu_value_i2c,      NULL},
+  {"CAT Baud",      6, select_menu_cat_baud, NULL,               get_menu_value_cat_baud, format_menu_value_cat_baud, NULL},
   {"Reset All",     2, select_menu_rst_all,  format_menu_no_val, get_menu_value_no,       format_menu_value_yes_no,   NULL}
 };
 
@@ -19,8 +19,11 @@
 #pragma GCC diagnostic pop
 
 #include <LiquidCrystal.h>
+#include <stddef.h>
 
 #include "rig.h"
+#include "cat_task.h"
+#include "bcd.h"
 #include "version.h"
 
 typedef struct {
@@ -69,26 +72,12 @@ static bool in_ham_band_range(uint8_t rgn, int32_t freq) {
 }
 
 #define EEPROM_MAGIC_NUMBER (0xF505)
-#define EEPROM_VERSION_NO (1)
+#define EEPROM_VERSION_NO (2)
 #define CHANNEL_SIZE (0x0010)
 
-#define ADDR_MAGIC_NUMBER (0x0000)
-#define ADDR_VERSION (0x0002)
-
-#define ADDR_LOCK (0x0004)
-#define ADDR_IS_VFO (0x0005)
-#define ADDR_MEM_CH_IDX (0x0006)
-#define ADDR_FREQ_ADJ_BASE (0x0007)
-
-#define ADDR_CW_TONE (0x0008)
-#define ADDR_CW_WPM (0x0009)
-#define ADDR_CW_DELAY (0x000A)
-#define ADDR_CW_KEY (0x000B)
-#define ADDR_ITU_RGN (0x000C)
-
-#define ADDR_CW_WPM_LOW (0x000D)
-
-// 0x000E - 0x002F reserved
+// The settings block is kept twice, written alternately
+#define ADDR_SETTINGS (0x0000) // Settings block: 0x0000 ~ 0x002F
+#define ADDR_SETTINGS_B (0x0090) // 2nd copy: 0x0090 ~ 0x00BF
 
 #define ADDR_CALLSIGN (0X0030)
 #define ADDR_CALLSIGN_LEN (0x0010)
@@ -96,241 +85,412 @@ static bool in_ham_band_range(uint8_t rgn, int32_t freq) {
 #define ADDR_AUTOKEY_TEXT (0x0040)
 #define ADDR_AUTOKEY_TEXT_LEN (0x0040)
 
-#define ADDR_MASTER_CALI (0x0080)
-#define ADDR_SSB_BFO (0x0084)
-#define ADDR_CW_BFO (0x0088)
+#define ADDR_V1_CALI (0x0080) // version 1: calibration and BFOs, 0x0080 ~ 0x008B
 
-// 0x008C - 0x008F reserved
+// 0x00C0 - 0x00EF reserved
 
-#define ADDR_VFOS (0x00F0) // 0x0100 - 0x0010
+#define ADDR_VFOS (0x00F0) // 0x0100 - 0x0010, before the VFO journal
 #define ADDR_MEM_CH_BEGIN (0x0100)  // MEM: 0x0100 ~ 0x02FF
 
-// 0x0300 - 0x03FF reserved
+#define ADDR_VFO_JOURNAL (0x0300) // VFO journal: 0x0300 ~ 0x03FF
+#define VFO_JOURNAL_SLOTS (16)
 
 #define EEPROM_SIZE (0x0400) // 1K
 
-inline bool eeprom_ok() {
-  uint16_t n = 0;
+// Write-behind cache. EEPROM writes are queued byte by byte and flushed one
+// byte per loop pass by Rig::flushEeprom(), only when the EEPROM is ready,
+// so a setting change never stalls the loop. Writing a byte that is already
+// pending moves it to the end of the queue, so the bytes reach the EEPROM in
+// the order they were written and a checksum always lands after its data.
+// Bytes equal to the stored value are dropped. Reads see the pending bytes.
 
-  EEPROM.get(ADDR_MAGIC_NUMBER, n);
-  if (n != EEPROM_MAGIC_NUMBER) return false;
-
-  EEPROM.get(ADDR_VERSION, n);
-  if (n != EEPROM_VERSION_NO) return false;
+#define EEPROM_WB_SIZE (24)
 
+typedef struct {
+  uint16_t addr;
+  uint8_t val;
+} EepromWbEntry;
+
+static EepromWbEntry eeprom_wb[EEPROM_WB_SIZE];
+static uint8_t eeprom_wb_head = 0;
+static uint8_t eeprom_wb_len = 0;
+
+static inline bool eeprom_wb_ready() {
+#ifdef __AVR__
+  return eeprom_is_ready();
+#else
   return true;
+#endif
 }
 
-void eeprom_write_head() {
-  uint16_t n = EEPROM_MAGIC_NUMBER;
-  EEPROM.put(ADDR_MAGIC_NUMBER, n);
+// The setup console owns the serial port, CAT must not read it then
+static bool eeprom_wb_console = false;
 
-  n = EEPROM_VERSION_NO;
-  EEPROM.put(ADDR_VERSION, n);
-}
+static bool eeprom_wb_flush_one() {
+  if (eeprom_wb_len == 0 || !eeprom_wb_ready()) return false;
 
-void eeprom_write_lock(uint8_t lock) {
-  EEPROM.put(ADDR_LOCK, lock);
-}
+  EepromWbEntry &e = eeprom_wb[eeprom_wb_head];
+  EEPROM.update(e.addr, e.val);
 
-void eeprom_read_lock(uint8_t &lock) {
-  EEPROM.get(ADDR_LOCK, lock);
-}
+  eeprom_wb_head = (eeprom_wb_head + 1) % EEPROM_WB_SIZE;
+  eeprom_wb_len --;
 
-void eeprom_write_is_vfo(bool is_vfo) {
-  EEPROM.put(ADDR_IS_VFO, is_vfo);
+  return true;
 }
 
-void eeprom_read_is_vfo(bool &is_vfo) {
-  EEPROM.get(ADDR_IS_VFO, is_vfo);
+// Waits for one byte to be written, keeping CAT frames coming in meanwhile
+static void eeprom_wb_flush_wait() {
+  if (!eeprom_wb_flush_one() && !eeprom_wb_console) catTask.pollSerial();
 }
 
-void eeprom_write_mem_ch_idx(int8_t idx) {
-  EEPROM.put(ADDR_MEM_CH_IDX, idx);
+static void eeprom_wb_flush_all() {
+  while (eeprom_wb_len > 0) eeprom_wb_flush_wait();
 }
 
-void eeprom_read_mem_ch_idx(int8_t &idx) {
-  EEPROM.get(ADDR_MEM_CH_IDX, idx);
-}
+static void eeprom_wb_put_byte(uint16_t addr, uint8_t val) {
+  for (uint8_t i = 0; i < eeprom_wb_len; i ++) {
+    if (eeprom_wb[(eeprom_wb_head + i) % EEPROM_WB_SIZE].addr == addr) {
+      for (; i < eeprom_wb_len - 1; i ++) {
+        eeprom_wb[(eeprom_wb_head + i) % EEPROM_WB_SIZE] = eeprom_wb[(eeprom_wb_head + i + 1) % EEPROM_WB_SIZE];
+      }
+      eeprom_wb_len --;
+      break;
+    }
+  }
 
-void eeprom_write_freq_adj_base(int32_t base) {
-  uint8_t n = 0;
+  if (EEPROM.read(addr) == val) return;
 
-  if (base == 10) n = 0;
-  else if (base == 100) n = 1;
-  else if (base == 1000) n = 2;
-  else if (base == 10000) n = 3;
-  else if (base == 100000) n = 4;
-  else if (base == 1000000) n = 5;
+  // queue is full - make room the slow way
+  while (eeprom_wb_len == EEPROM_WB_SIZE) eeprom_wb_flush_wait();
 
-  EEPROM.put(ADDR_FREQ_ADJ_BASE, n);
+  EepromWbEntry &e = eeprom_wb[(eeprom_wb_head + eeprom_wb_len) % EEPROM_WB_SIZE];
+  e.addr = addr;
+  e.val = val;
+  eeprom_wb_len ++;
 }
 
-void eeprom_read_freq_adj_base(int32_t &base) {
-  uint8_t n;
+template <typename T> const T &eeprom_put(uint16_t addr, const T &t) {
+  const uint8_t *p = (const uint8_t *)&t;
 
-  EEPROM.get(ADDR_FREQ_ADJ_BASE, n);
+  for (uint8_t i = 0; i < sizeof(T); i ++) {
+    eeprom_wb_put_byte(addr + i, p[i]);
+  }
 
-  if (n == 0) base = 10;
-  else if (n == 1) base = 100;
-  else if (n == 2) base = 1000;
-  else if (n == 3) base = 10000;
-  else if (n == 4) base = 100000;
-  else if (n == 5) base = 1000000;
+  return t;
 }
 
-void eeprom_write_cw_tone(uint16_t tone) {
-  int8_t n = (tone - 400) / 50;
+template <typename T> T &eeprom_get(uint16_t addr, T &t) {
+  EEPROM.get(addr, t);
 
-  if (n < 0) n = 0;
-  else if (n > 32) n = 32;
+  uint8_t *p = (uint8_t *)&t;
+  for (uint8_t i = 0; i < eeprom_wb_len; i ++) {
+    EepromWbEntry &e = eeprom_wb[(eeprom_wb_head + i) % EEPROM_WB_SIZE];
+    if (e.addr >= addr && e.addr < addr + sizeof(T)) {
+      p[e.addr - addr] = e.val;
+    }
+  }
 
-  EEPROM.put(ADDR_CW_TONE, n);
+  return t;
 }
 
-void eeprom_read_cw_tone(uint16_t &tone) {
-  int8_t n;
+// All the settings live in one packed block, which is read into RAM with a
+// single pass at boot and validated once. The getters read the RAM copy.
+// Every save writes the whole block over the older of two copies, with the
+// next seq, so a power loss while writing leaves the other copy intact.
+#pragma pack(push, 1)
 
-  EEPROM.get(ADDR_CW_TONE, n);
+typedef struct {
+  uint16_t magic;
+  uint16_t version;
 
-  if (n < 0) n = 0;
-  else if (n > 32) n = 32;
+  uint8_t dial_lock;
+  uint8_t is_vfo;
+  int8_t mem_ch_idx;
+  uint8_t itu_rgn;
+  int32_t freq_adj_base;
 
-  tone = n * 50 + 400;
-}
+  uint16_t cw_tone;
+  uint8_t cw_wpm;
+  uint8_t cw_wpm_low;
+  uint16_t cw_delay;
+  uint8_t cw_key;
 
-void eeprom_write_cw_wpm(uint8_t wpm) {
-  if (wpm < 5) wpm = 5;
-  else if (wpm > 60) wpm = 60;
+  uint8_t i2c_fast;
+  int32_t master_cali;
+  uint32_t ssb_bfo;
+  uint32_t cw_bfo;
 
-  wpm -=5;
+  uint8_t cat_baud; // CAT_BAUD_*, was reserved (zero)
 
-  EEPROM.put(ADDR_CW_WPM, wpm);
-}
+  uint8_t seq; // the newer valid copy wins
 
-void eeprom_read_cw_wpm(uint8_t &wpm) {
-  EEPROM.get(ADDR_CW_WPM, wpm);
+  uint8_t reserved[4]; // zero - for new settings without a version change
 
-  wpm += 5;
+  uint8_t sum;
+} Settings;
 
-  if (wpm < 5) wpm = 5;
-  else if (wpm > 60) wpm = 60;
-}
+// Version 1 kept the settings as single bytes, calibration and BFOs apart
+typedef struct {
+  uint16_t magic;
+  uint16_t version;
+
+  uint8_t dial_lock;
+  uint8_t is_vfo;
+  int8_t mem_ch_idx;
+  uint8_t freq_adj_base; // 0: 10Hz ... 5: 1MHz
+  int8_t cw_tone; // (tone - 400) / 50
+  uint8_t cw_wpm; // wpm - 5
+  uint8_t cw_delay; // ms / 100
+  uint8_t cw_key;
+  uint8_t itu_rgn;
+  uint8_t cw_wpm_low; // wpm - 5
+} SettingsV1;
+
+typedef struct {
+  int32_t master_cali;
+  uint32_t ssb_bfo;
+  uint32_t cw_bfo;
+} SettingsV1Cali;
 
-void eeprom_write_cw_wpm_low(uint8_t wpm) {
-  if (wpm < 5) wpm = 5;
-  else if (wpm > 60) wpm = 60;
+#pragma pack(pop)
 
-  wpm -=5;
+static Settings settings;
+static uint8_t settings_slot = 0; // the copy last written
 
-  EEPROM.put(ADDR_CW_WPM_LOW, wpm);
+static inline uint16_t settings_addr(uint8_t slot) {
+  return slot == 0 ? ADDR_SETTINGS : ADDR_SETTINGS_B;
 }
 
-void eeprom_read_cw_wpm_low(uint8_t &wpm) {
-  EEPROM.get(ADDR_CW_WPM_LOW, wpm);
+static uint8_t settings_sum(const Settings &s) {
+  const uint8_t *p = (const uint8_t *)&s;
+  uint8_t sum = 0;
 
-  wpm += 5;
+  for (uint8_t i = 0; i < offsetof(Settings, sum); i ++) sum += p[i];
 
-  if (wpm < 5) wpm = 5;
-  else if (wpm > 60) wpm = 60;
+  return ~sum;
 }
 
-void eeprom_write_cw_delay(uint16_t delay) {
-  uint8_t n = delay / 100;
+static bool settings_read(uint8_t slot, Settings &s) {
+  eeprom_get(settings_addr(slot), s);
 
-  EEPROM.put(ADDR_CW_DELAY, n);
+  if (s.magic != EEPROM_MAGIC_NUMBER) return false;
+  if (s.version != EEPROM_VERSION_NO) return false;
+
+  return s.sum == settings_sum(s);
 }
 
-void eeprom_read_cw_delay(uint16_t &delay) {
-  uint8_t n;
+// true if any copy was written by this firmware, valid or not
+static bool settings_found() {
+  uint16_t magic;
 
-  EEPROM.get(ADDR_CW_DELAY, n);
+  for (uint8_t slot = 0; slot < 2; slot ++) {
+    eeprom_get(settings_addr(slot), magic);
+    if (magic == EEPROM_MAGIC_NUMBER) return true;
+  }
 
-  delay = n * 100;
+  return false;
 }
 
-void eeprom_write_cw_key(uint8_t key) {
-  EEPROM.put(ADDR_CW_KEY, key);
+static bool settings_read_v1() {
+  SettingsV1 v1;
+  SettingsV1Cali cali;
+
+  eeprom_get(ADDR_SETTINGS, v1);
+  if (v1.magic != EEPROM_MAGIC_NUMBER || v1.version != 1) return false;
+
+  eeprom_get(ADDR_V1_CALI, cali);
+
+  memset(&settings, 0, sizeof(settings));
+
+  settings.dial_lock = v1.dial_lock;
+  settings.is_vfo = v1.is_vfo;
+  settings.mem_ch_idx = v1.mem_ch_idx;
+  settings.itu_rgn = v1.itu_rgn;
+  settings.freq_adj_base = 10;
+  for (uint8_t i = 0; i < v1.freq_adj_base && i < 5; i ++) settings.freq_adj_base *= 10;
+
+  settings.cw_tone = (v1.cw_tone < 0 ? 0 : v1.cw_tone) * 50 + 400;
+  settings.cw_wpm = v1.cw_wpm + 5;
+  settings.cw_wpm_low = v1.cw_wpm_low + 5;
+  settings.cw_delay = v1.cw_delay * 100;
+  settings.cw_key = v1.cw_key;
+
+  settings.i2c_fast = OFF;
+  settings.master_cali = cali.master_cali;
+  settings.ssb_bfo = cali.ssb_bfo;
+  settings.cw_bfo = cali.cw_bfo;
+  settings.cat_baud = CAT_BAUD_19200;
+
+  // the first save goes to the 2nd copy, the old block stays until it is done
+  settings_slot = 0;
+
+  return true;
 }
 
-void eeprom_read_cw_key(uint8_t &key) {
-  EEPROM.get(ADDR_CW_KEY, key);
+static void settings_save_all();
+
+static bool settings_load() {
+  Settings s;
+  bool found = false, migrated = false;
+
+  for (uint8_t slot = 0; slot < 2; slot ++) {
+    if (!settings_read(slot, s)) continue;
+
+    if ((!found) || (int8_t)(s.seq - settings.seq) > 0) {
+      found = true;
+      settings_slot = slot;
+      memcpy(&settings, &s, sizeof(s));
+    }
+  }
+
+  if (!found) {
+    if (!settings_read_v1()) return false;
+    migrated = true;
+  }
+
+  // keep the values in range, whatever was stored
+  if (settings.mem_ch_idx < 0 || settings.mem_ch_idx >= MEM_SIZE) settings.mem_ch_idx = 0;
+  if (settings.itu_rgn < 1 || settings.itu_rgn > 3) settings.itu_rgn = 3;
+  if (settings.freq_adj_base < 10 || settings.freq_adj_base > 1000000) settings.freq_adj_base = 100;
+  if (settings.cw_tone < 400 || settings.cw_tone > 2000) settings.cw_tone = 700;
+  if (settings.cw_wpm < 5 || settings.cw_wpm > 60) settings.cw_wpm = 15;
+  if (settings.cw_wpm_low < 5 || settings.cw_wpm_low > 60) settings.cw_wpm_low = 15;
+  if (settings.cw_delay > 1000) settings.cw_delay = 500;
+  if (settings.cw_key > CW_KEY_IAMBIC_B_R) settings.cw_key = CW_KEY_IAMBIC_B_R;
+  if (settings.i2c_fast > ON) settings.i2c_fast = OFF;
+  if (settings.cat_baud >= CAT_BAUD_COUNT) settings.cat_baud = CAT_BAUD_19200;
+
+  if (migrated) settings_save_all();
 
-  if (key > 4) key = 4;
+  return true;
 }
 
-void eeprom_write_itu_rgn(uint8_t rgn) {
-  EEPROM.put(ADDR_ITU_RGN, rgn);
+// Writes the whole block over the older copy. Only the bytes that differ
+// from it are queued, the checksum last. Nothing is written if the newer
+// copy already holds the same values.
+static void settings_save() {
+  Settings s;
+
+  settings.sum = settings_sum(settings);
+  eeprom_get(settings_addr(settings_slot), s);
+  if (memcmp(&s, &settings, sizeof(s)) == 0) return;
+
+  settings_slot ^= 1;
+  settings.seq ++;
+  settings.sum = settings_sum(settings);
+
+  eeprom_put(settings_addr(settings_slot), settings);
 }
 
-void eeprom_read_itu_rgn(uint8_t &rgn) {
-  EEPROM.get(ADDR_ITU_RGN, rgn);
+static void settings_save_all() {
+  settings.magic = EEPROM_MAGIC_NUMBER;
+  settings.version = EEPROM_VERSION_NO;
+  memset(settings.reserved, 0, sizeof(settings.reserved));
 
-  if (rgn > 3) rgn = 3;
+  settings_save();
 }
 
 void eeprom_write_callsign_ch(uint8_t offset, char ch) {
   if (offset < ADDR_CALLSIGN_LEN) {
-    EEPROM.put(ADDR_CALLSIGN + offset, ch);
+    eeprom_put(ADDR_CALLSIGN + offset, ch);
   }
 }
 
 void eeprom_read_callsign_ch(uint8_t offset, char &ch) {
   if (offset < ADDR_CALLSIGN_LEN) {
-    EEPROM.get(ADDR_CALLSIGN + offset, ch);
+    eeprom_get(ADDR_CALLSIGN + offset, ch);
   }
 }
 
 void eeprom_write_autokey_text_ch(uint8_t offset, char ch) {
   if (offset < ADDR_AUTOKEY_TEXT_LEN) {
-    EEPROM.put(ADDR_AUTOKEY_TEXT + offset, ch);
+    eeprom_put(ADDR_AUTOKEY_TEXT + offset, ch);
   }
 }
 
 void eeprom_read_autokey_text_ch(uint8_t offset, char &ch) {
   if (offset < ADDR_AUTOKEY_TEXT_LEN) {
-    EEPROM.get(ADDR_AUTOKEY_TEXT + offset, ch);
+    eeprom_get(ADDR_AUTOKEY_TEXT + offset, ch);
   }
 }
 
-void eeprom_write_master_cali(int32_t cali) {
-  EEPROM.put(ADDR_MASTER_CALI, cali);
-}
+// The VFO channel is saved round-robin into the slots of the journal, so the
+// wear is spread over 16 records. The record with the newest valid seq wins.
+#pragma pack(push, 1)
 
-void eeprom_read_master_cali(int32_t &cali) {
-  EEPROM.get(ADDR_MASTER_CALI, cali);
-}
+// 16 bytes
+typedef struct {
+  uint16_t seq;
+  Channel ch;
+  uint8_t sum;
+  uint8_t reserved;
+} VfoRecord;
 
-void eeprom_write_ssb_bfo(uint32_t bfo) {
-  EEPROM.put(ADDR_SSB_BFO, bfo);
-}
+#pragma pack(pop)
 
-void eeprom_read_ssb_bfo(uint32_t &bfo) {
-  EEPROM.get(ADDR_SSB_BFO, bfo);
-}
+static uint8_t vfo_journal_slot = VFO_JOURNAL_SLOTS - 1;
+static uint16_t vfo_journal_seq = 0;
 
-void eeprom_write_cw_bfo(uint32_t bfo) {
-  EEPROM.put(ADDR_CW_BFO, bfo);
+static uint8_t vfo_record_sum(const VfoRecord &rec) {
+  const uint8_t *p = (const uint8_t *)&rec;
+  uint8_t sum = 0;
+
+  for (uint8_t i = 0; i < offsetof(VfoRecord, sum); i ++) sum += p[i];
+
+  return ~sum; // neither erased (0xFF) nor zeroed records pass
 }
 
-void eeprom_read_cw_bfo(uint32_t &bfo) {
-  EEPROM.get(ADDR_CW_BFO, bfo);
+// Returns false if the journal holds no valid record
+static bool eeprom_find_vfo_record(VfoRecord &newest) {
+  VfoRecord rec;
+  bool found = false;
+
+  for (uint8_t i = 0; i < VFO_JOURNAL_SLOTS; i ++) {
+    eeprom_get(ADDR_VFO_JOURNAL + sizeof(VfoRecord) * i, rec);
+    if (rec.sum != vfo_record_sum(rec)) continue;
+
+    if ((!found) || (int16_t)(rec.seq - vfo_journal_seq) > 0) {
+      found = true;
+      vfo_journal_slot = i;
+      vfo_journal_seq = rec.seq;
+      memcpy(&newest, &rec, sizeof(rec));
+    }
+  }
+
+  return found;
 }
 
 void eeprom_write_vfos(const Channel &ch) {
-  EEPROM.put(ADDR_VFOS, ch);
+  VfoRecord rec;
+
+  vfo_journal_slot = (vfo_journal_slot + 1) % VFO_JOURNAL_SLOTS;
+  vfo_journal_seq ++;
+
+  rec.seq = vfo_journal_seq;
+  memcpy(&rec.ch, &ch, sizeof(Channel));
+  rec.sum = vfo_record_sum(rec);
+  rec.reserved = 0xFF;
+
+  eeprom_put(ADDR_VFO_JOURNAL + sizeof(VfoRecord) * vfo_journal_slot, rec);
 }
 
 void eeprom_read_vfos(Channel &ch) {
-  EEPROM.get(ADDR_VFOS, ch);
+  VfoRecord rec;
+
+  if (eeprom_find_vfo_record(rec)) {
+    memcpy(&ch, &rec.ch, sizeof(Channel));
+  } else {
+    // saved before the journal existed
+    eeprom_get(ADDR_VFOS, ch);
+  }
 }
 
 void eeprom_write_mem_ch(int8_t idx, const Channel &ch) {
-  EEPROM.put(ADDR_MEM_CH_BEGIN + CHANNEL_SIZE * idx, ch);
+  eeprom_put(ADDR_MEM_CH_BEGIN + CHANNEL_SIZE * idx, ch);
 }
 
 void eeprom_read_mem_ch(int8_t idx, Channel &ch) {
-  EEPROM.get(ADDR_MEM_CH_BEGIN + CHANNEL_SIZE * idx, ch);
+  eeprom_get(ADDR_MEM_CH_BEGIN + CHANNEL_SIZE * idx, ch);
 }
 
 inline void init_channel(Channel *ch) {
@@ -349,26 +509,33 @@ inline void copy_channel(Channel *dest, const Channel *src) {
   memcpy(dest, src, sizeof(Channel));
 }
 
+inline bool is_channel_ok(const Channel &ch) {
+  return ch.vfos[ch.active_vfo].freq != 0;
+}
+
 void Rig::init() {
   pinMode(LED_BUILTIN, OUTPUT);
   digitalWrite(LED_BUILTIN, LOW);
 
   _tx = OFF;
+  _bcd_freq = -1;
 
-  if (eeprom_ok()) {
-    Device::loadSettings();
+  // also locates the journal head, needed even when everything is reset
+  eeprom_read_vfos(_vfo_ch);
 
-    eeprom_read_lock(_dial_lock);
-    eeprom_read_is_vfo(_is_vfo);
-    eeprom_read_mem_ch_idx(_ch_idx);
+  bool ok = settings_load();
 
-    eeprom_read_vfos(_vfo_ch);
-    eeprom_read_vfos(_vfo_ch_saved);
-    eeprom_read_mem_ch(_ch_idx, _mem_ch);
-    eeprom_read_freq_adj_base(_freq_adj_base);
-    eeprom_read_itu_rgn(_rgn);
+  if (ok || settings_found()) {
+    // a damaged block resets the settings only, channels and VFOs stay
+    if (!ok) resetSettings();
+
+    Device::loadSettings();
+
+    copy_channel(&_vfo_ch_saved, &_vfo_ch);
+    eeprom_read_mem_ch(settings.mem_ch_idx, _mem_ch);
+    loadMemOkBits();
 
-    if (_is_vfo) _working_ch = &_vfo_ch;
+    if (settings.is_vfo) _working_ch = &_vfo_ch;
     else _working_ch = &_mem_ch;
   } else {
     resetAll();
@@ -379,33 +546,30 @@ void Rig::init() {
   updateDeviceFreqMode();
 }
 
-void Rig::resetAll() {
-  _dial_lock = OFF;
+void Rig::resetSettings() {
+  settings.dial_lock = OFF;
+  settings.mem_ch_idx = 0;
+  settings.freq_adj_base = 100;
+  settings.itu_rgn = 3;
+  settings.is_vfo = true;
+
+  Device::resetAll();
 
+  settings_save_all();
+}
+
+void Rig::resetAll() {
   // init mem with empty channels
   memset(&_mem_ch, 0, sizeof(_mem_ch));
-
-  _ch_idx = 0;
-  _freq_adj_base = 100;
-  _rgn = 3;
+  _mem_ok_bits = 0;
 
   init_channel(&_vfo_ch);
   init_channel(&_vfo_ch_saved);
 
-  _is_vfo = true;
   _working_ch = &_vfo_ch;
 
   // reset eeprom
-  eeprom_write_head();
-
-  Device::resetAll();
-  Device::saveSettings();
-
-  eeprom_write_lock(_dial_lock);
-  eeprom_write_is_vfo(_is_vfo);
-  eeprom_write_mem_ch_idx(_ch_idx);
-  eeprom_write_freq_adj_base(_freq_adj_base);
-  eeprom_write_itu_rgn(_rgn);
+  resetSettings();
 
   char ch = 0;
   eeprom_write_callsign_ch(0, ch);
@@ -459,6 +623,26 @@ int32_t Rig::getFreq() {
   return getTx() == ON ? getTxFreq() : getRxFreq();
 }
 
+int32_t Rig::getVfoFreq(uint8_t idx) {
+  return _working_ch->vfos[idx & 0x01].freq;
+}
+
+uint8_t Rig::getVfoMode(uint8_t idx) {
+  return _working_ch->vfos[idx & 0x01].mode;
+}
+
+// Converted again only when getFreq() has moved, whatever moved it
+const uint8_t *Rig::getFreqBcd() {
+  int32_t freq = getFreq();
+
+  if (freq != _bcd_freq) {
+    freq2bcd(freq, _freq_bcd);
+    _bcd_freq = freq;
+  }
+
+  return _freq_bcd;
+}
+
 int32_t Rig::getFreqAnother() {
   uint8_t v = getVfo() == VFO_A ? VFO_B : VFO_A;
   return _working_ch->vfos[v].freq;
@@ -510,7 +694,7 @@ uint8_t Rig::getModeAnother() {
 void Rig::setTx(uint8_t tx) {
   if ((tx == ON || tx == OFF) && (tx != _tx)) {
 
-    if (tx == ON && (!in_ham_band_range(_rgn, getTxFreq()))) return;
+    if (tx == ON && (!in_ham_band_range(settings.itu_rgn, getTxFreq()))) return;
 
     _tx = tx;
 
@@ -601,22 +785,21 @@ uint8_t Rig::getSplit() { return _working_ch->split; };
 void Rig::setDialLock(uint8_t val, bool need_update) {
   if (getTx() == ON) return;
 
-  _dial_lock = val;
-
-  eeprom_write_lock(_dial_lock);
+  settings.dial_lock = val;
+  settings_save();
 
   if (need_update) rigChanged();
 }
 
-uint8_t Rig::getDialLock() { return _dial_lock; };
+uint8_t Rig::getDialLock() { return settings.dial_lock; };
 
 void Rig::selectVfo(bool need_update) {
   if (getTx() == ON) return;
 
   _working_ch = &_vfo_ch;
 
-  _is_vfo = true;
-  eeprom_write_is_vfo(_is_vfo);
+  settings.is_vfo = true;
+  settings_save();
 
   if (need_update) rigChanged();
 }
@@ -627,8 +810,8 @@ bool Rig::selectMem(bool need_update) {
   if (isMemOk()) {
     _working_ch = &_mem_ch;
 
-    _is_vfo = false;
-    eeprom_write_is_vfo(_is_vfo);
+    settings.is_vfo = false;
+    settings_save();
 
     updateDeviceFreqMode();
 
@@ -646,9 +829,9 @@ bool Rig::selectMemCh(int8_t ch, bool need_update) {
   if (ch < 0 || ch >= MEM_SIZE) {
     return false;
   } else {
-    _ch_idx = ch;
-    eeprom_read_mem_ch(_ch_idx, _mem_ch);
-    eeprom_write_mem_ch_idx(_ch_idx);
+    settings.mem_ch_idx = ch;
+    eeprom_read_mem_ch(settings.mem_ch_idx, _mem_ch);
+    settings_save();
 
     if (!isMemOk()) selectVfo(false);
 
@@ -660,7 +843,7 @@ bool Rig::selectMemCh(int8_t ch, bool need_update) {
 }
 
 int8_t Rig::getMemCh() {
-  return _ch_idx;
+  return settings.mem_ch_idx;
 }
 
 void Rig::writeMemory(int8_t ch_idx, bool need_update) {
@@ -668,7 +851,8 @@ void Rig::writeMemory(int8_t ch_idx, bool need_update) {
 
   if (isVfo()) {
     copy_channel(&_mem_ch, _working_ch);
-    eeprom_write_mem_ch(ch_idx == -1 ? _ch_idx : ch_idx, _mem_ch);
+    eeprom_write_mem_ch(ch_idx == -1 ? settings.mem_ch_idx : ch_idx, _mem_ch);
+    setMemOkBit(ch_idx == -1 ? settings.mem_ch_idx : ch_idx, _mem_ch);
     if (need_update) rigChanged();
   }
 }
@@ -676,8 +860,8 @@ void Rig::writeMemory(int8_t ch_idx, bool need_update) {
 void Rig::memoryToVfo(int8_t ch_idx, bool need_update) {
   if (getTx() == ON) return;
 
-  if (isMemOk(ch_idx == -1 ? _ch_idx : ch_idx)) {
-    eeprom_read_mem_ch(ch_idx == -1 ? _ch_idx : ch_idx, _vfo_ch);
+  if (isMemOk(ch_idx == -1 ? settings.mem_ch_idx : ch_idx)) {
+    eeprom_read_mem_ch(ch_idx == -1 ? settings.mem_ch_idx : ch_idx, _vfo_ch);
 
     updateDeviceFreqMode();
 
@@ -690,54 +874,107 @@ void Rig::clearMemory(bool need_update) {
 
   selectVfo(false);
   memset(&_mem_ch, 0, sizeof(Channel));
-  eeprom_write_mem_ch(_ch_idx, _mem_ch);
+  eeprom_write_mem_ch(settings.mem_ch_idx, _mem_ch);
+  setMemOkBit(settings.mem_ch_idx, _mem_ch);
 
   updateDeviceFreqMode();
 
   if (need_update) rigChanged();
 }
 
+bool Rig::readMemCh(int8_t ch_idx, Channel &ch) {
+  if (!isMemOk(ch_idx)) return false;
+
+  eeprom_read_mem_ch(ch_idx, ch);
+
+  return true;
+}
+
+bool Rig::writeMemCh(int8_t ch_idx, const Channel *ch, bool need_update) {
+  if (getTx() == ON || ch_idx < 0 || ch_idx >= MEM_SIZE) return false;
+
+  Channel c;
+
+  if (ch == NULL) {
+    memset(&c, 0, sizeof(Channel));
+  } else {
+    copy_channel(&c, ch);
+  }
+
+  eeprom_write_mem_ch(ch_idx, c);
+  setMemOkBit(ch_idx, c);
+
+  // only the channel in use needs the rig retuned
+  if (ch_idx == settings.mem_ch_idx) {
+    copy_channel(&_mem_ch, &c);
+
+    if (!isVfo()) {
+      // cleared under the rig: back to the VFO, as clearMemory() does
+      if (!is_channel_ok(c)) selectVfo(false);
+
+      updateDeviceFreqMode();
+
+      if (need_update) rigChanged();
+    }
+  }
+
+  return true;
+}
+
 bool Rig::isVfo() {
   return _working_ch == (&_vfo_ch);
 }
 
 bool Rig::isMemOk() {
-  return isMemOk(_ch_idx);
+  return isMemOk(settings.mem_ch_idx);
 }
 
 bool Rig::isMemOk(int8_t ch_idx) {
-  Channel ch;
-  eeprom_read_mem_ch(ch_idx, ch);
+  if (ch_idx < 0 || ch_idx >= MEM_SIZE) return false;
 
-  return ch.vfos[ch.active_vfo].freq != 0;
+  return (_mem_ok_bits & (1UL << ch_idx)) != 0;
 }
 
 int8_t Rig::getPrevMemOkCh(int8_t ch_idx) {
-  int8_t result = -1;
+  if (_mem_ok_bits == 0) return -1;
 
-  for (int8_t i = ch_idx - 1 + MEM_SIZE; i >= ch_idx; i --) {
-    int8_t ch = i % MEM_SIZE;
-    if (isMemOk(ch)) {
-      result = ch;
-      break;
-    }
-  }
+  int8_t ch = ch_idx;
+  do {
+    ch = (ch <= 0 ? MEM_SIZE : ch) - 1;
+  } while ((_mem_ok_bits & (1UL << ch)) == 0);
 
-  return result;
+  return ch;
 }
 
 int8_t Rig::getNextMemOkCh(int8_t ch_idx) {
-  int8_t result = -1;
+  if (_mem_ok_bits == 0) return -1;
 
-  for (int8_t i = ch_idx + 1; i <= ch_idx + MEM_SIZE; i ++) {
-    int8_t ch = i % MEM_SIZE;
-    if (isMemOk(ch)) {
-      result = ch;
-      break;
-    }
+  int8_t ch = ch_idx;
+  do {
+    ch = (ch + 1 == MEM_SIZE ? 0 : ch + 1);
+  } while ((_mem_ok_bits & (1UL << ch)) == 0);
+
+  return ch;
+}
+
+// Only place that scans the channels in EEPROM. Done once at init, and when
+// the memory area was written via CAT.
+void Rig::loadMemOkBits() {
+  Channel ch;
+
+  _mem_ok_bits = 0;
+  for (int8_t i = 0; i < MEM_SIZE; i ++) {
+    eeprom_read_mem_ch(i, ch);
+    setMemOkBit(i, ch);
   }
+}
 
-  return result;
+void Rig::setMemOkBit(int8_t ch_idx, const Channel &ch) {
+  if (is_channel_ok(ch)) {
+    _mem_ok_bits |= (1UL << ch_idx);
+  } else {
+    _mem_ok_bits &= ~(1UL << ch_idx);
+  }
 }
 
 void Rig::saveVfoCh() {
@@ -754,21 +991,26 @@ void Rig::saveVfoCh() {
   }
 }
 
+void Rig::flushEeprom() {
+  eeprom_wb_flush_one();
+}
+
 void Rig::setFreqAdjBase(int32_t base) {
-  _freq_adj_base = base;
-  eeprom_write_freq_adj_base(_freq_adj_base);
+  settings.freq_adj_base = base;
+  settings_save();
 }
 
 int32_t Rig::getFreqAdjBase() {
-  return _freq_adj_base;
+  return settings.freq_adj_base;
 }
 
 void Rig::setItuRegion(uint8_t rgn) {
-  _rgn = rgn;
+  settings.itu_rgn = rgn;
+  settings_save();
 }
 
 uint8_t Rig::getItuRegion() {
-  return _rgn;
+  return settings.itu_rgn;
 }
 
 void Rig::getAutokeyTextCh(uint8_t idx, char &ch) {
@@ -791,14 +1033,13 @@ bool Rig::writeEepromBcd(uint16_t addr, uint8_t len, const uint8_t *data) {
   if (addr >= EEPROM_SIZE || len > eeprom_rw_bcd_max_len || (addr + len) > EEPROM_SIZE) return false;
 
   for (uint8_t i = 0; i < len; i ++) {
-    uint8_t val = 0;
-    val += (data[i * 2] & 0x0F) * 100;
-    val += (data[i * 2 + 1] >> 4) * 10;
-    val += (data[i * 2 + 1] & 0x0F);
+    uint8_t val = bcd2byte(&data[i * 2]);
 
-    EEPROM.put(addr + i, val);
+    eeprom_put(addr + i, val);
   }
 
+  reloadEeprom(addr, len);
+
   return true;
 }
 
@@ -807,10 +1048,73 @@ bool Rig::readEepromBcd(uint16_t addr, uint8_t len, uint8_t *data) {
 
   for (uint8_t i = 0; i < len; i ++) {
     uint8_t val = 0;
-    EEPROM.get(addr + i, val);
+    eeprom_get(addr + i, val);
+
+    byte2bcd(val, &data[i * 2]);
+  }
+
+  return true;
+}
+
+static inline bool eeprom_overlaps(uint16_t addr, uint16_t len, uint16_t from, uint16_t from_len) {
+  return addr + len > from && addr < from + from_len;
+}
+
+// A write over CAT must not leave the RAM copies stale, or the next save
+// would write them back over the new bytes
+void Rig::reloadEeprom(uint16_t addr, uint16_t len) {
+  bool reloaded = false;
+
+  if ((eeprom_overlaps(addr, len, ADDR_SETTINGS, sizeof(Settings)) ||
+      eeprom_overlaps(addr, len, ADDR_SETTINGS_B, sizeof(Settings))) && settings_load()) {
+    Device::loadSettings();
+    si5351_set_calibration(calibration);
+    Device::invalidateHardware();
+    eeprom_read_mem_ch(settings.mem_ch_idx, _mem_ch);
+    reloaded = true;
+  }
+
+  if (eeprom_overlaps(addr, len, ADDR_VFOS, CHANNEL_SIZE) ||
+      eeprom_overlaps(addr, len, ADDR_VFO_JOURNAL, sizeof(VfoRecord) * VFO_JOURNAL_SLOTS)) {
+    eeprom_read_vfos(_vfo_ch);
+    copy_channel(&_vfo_ch_saved, &_vfo_ch);
+    reloaded = true;
+  }
+
+  if (eeprom_overlaps(addr, len, ADDR_MEM_CH_BEGIN, CHANNEL_SIZE * MEM_SIZE)) {
+    loadMemOkBits();
+    eeprom_read_mem_ch(settings.mem_ch_idx, _mem_ch);
+    reloaded = true;
+  }
+
+  if (reloaded) {
+    // never stay on an empty memory channel
+    _working_ch = (settings.is_vfo || !isMemOk()) ? &_vfo_ch : &_mem_ch;
+
+    updateDeviceFreqMode();
+    rigChanged();
+  }
+}
+
+bool Rig::writeEepromBlock(uint8_t blk, const uint8_t *data) {
+  uint16_t addr = (uint16_t)blk * EEPROM_BLOCK_SIZE;
+  if (addr >= EEPROM_SIZE) return false;
+
+  for (uint8_t i = 0; i < EEPROM_BLOCK_SIZE; i ++) {
+    eeprom_put(addr + i, data[i]);
+  }
 
-    data[i * 2] = (val / 100);
-    data[i * 2 + 1] = (((val % 100) / 10) << 4) + (val % 10);
+  reloadEeprom(addr, EEPROM_BLOCK_SIZE);
+
+  return true;
+}
+
+bool Rig::readEepromBlock(uint8_t blk, uint8_t *data) {
+  uint16_t addr = (uint16_t)blk * EEPROM_BLOCK_SIZE;
+  if (addr >= EEPROM_SIZE) return false;
+
+  for (uint8_t i = 0; i < EEPROM_BLOCK_SIZE; i ++) {
+    eeprom_get(addr + i, data[i]);
   }
 
   return true;
@@ -872,7 +1176,9 @@ void Rig::serialSetup() {
   lcd.setCursor(0, 1);
   lcd.print(F("19200 8N1 NoEcho"));
 
-  Serial.flush();
+  // always 19200, whatever the CAT rate is
+  catTask.setBaud(CAT_BAUD_19200);
+  eeprom_wb_console = true;
 
   Serial.print(F("\r\nPress <ENTER> to start..."));
   serialReadString(buf, 1);
@@ -897,11 +1203,18 @@ void Rig::serialSetup() {
     }
 
     Serial.print(F("\r\n3. CW key slow WPM: "));
-    eeprom_read_cw_wpm_low(i);
-    sprintf(buf, "%d", i);
+    sprintf(buf, "%d", settings.cw_wpm_low);
     Serial.print(buf);
-    
-    Serial.print(F("\r\n\r\nPower off the uBitx when done. Choose [1, 2, 3]: "));
+
+    Serial.print(F("\r\n4. CAT baud rate: "));
+    if (settings.cat_baud == CAT_BAUD_AUTO) {
+      Serial.print(F("Auto"));
+    } else {
+      sprintf(buf, "%" PRIu32, CatTask::getBaudRate(settings.cat_baud));
+      Serial.print(buf);
+    }
+
+    Serial.print(F("\r\n\r\nPower off the uBitx when done. Choose [1, 2, 3, 4]: "));
 
     if (serialReadString(buf, 2)) {
       switch (buf[0]) {
@@ -934,13 +1247,30 @@ void Rig::serialSetup() {
         if (serialReadString(buf, 3)) {
           i = atoi(buf);
           if (i >= 5 && i <= 60) {
-            eeprom_write_cw_wpm_low(i);
+            settings.cw_wpm_low = i;
+            settings_save();
+          }
+        }
+        break;
+      case '4':
+        Serial.print(F("\r\n\r\nInput CAT baud rate (0 for Auto, 9600-115200): "));
+        if (serialReadString(buf, 7)) {
+          uint32_t rate = atol(buf);
+          for (i = 0; i < CAT_BAUD_COUNT; i ++) {
+            if (CatTask::getBaudRate(i) == rate) {
+              settings.cat_baud = i;
+              settings_save();
+              break;
+            }
           }
         }
         break;
       default:
         break;
       }
+
+      // the setup never returns, so write the changes out right now
+      eeprom_wb_flush_all();
     }
   }
 }
@@ -951,6 +1281,8 @@ void Rig::updateDeviceFreqMode() {
   } else {
     Device::setFreqMode(getTxFreq(), getTxMode(), getTx());
   }
+
+  catTask.rigChanged();
 }
 
 ///////////
@@ -970,14 +1302,13 @@ int32_t Device::_freq = -1;
 uint8_t Device::_mode = 0;
 uint8_t Device::_tx = 0;
 
-uint32_t Device::_ssbBfo = 11995000L;
-uint32_t Device::_cwBfo = 11995000L;
-uint16_t Device::_cwTone = 700;
-uint8_t Device::_cwWpm = 15;
-uint8_t Device::_cwWpmLow = 15;
-uint16_t Device::_cwSpeed = 1200 / Device::_cwWpm;
-uint16_t Device::_cwDelay = 500;
-uint8_t Device::_cwKey = CW_KEY_IAMBIC_B_R;
+int8_t Device::_hwLpf = -1;
+int8_t Device::_hwTx = -1;
+uint32_t Device::_hwClk[3] = { 0xFFFFFFFFL, 0xFFFFFFFFL, 0xFFFFFFFFL };
+
+uint32_t Device::_calBfo = 0;
+
+uint16_t Device::_cwSpeed = 1200 / 15;
 
 Device::Device() {
   calibration = 0;
@@ -1008,44 +1339,33 @@ void Device::init() {
   digitalWrite(TX_LPF_C, 0);
 
   // si5351bx
+  si5351bx_i2c_fast = settings.i2c_fast;
   initOscillators();
-}
 
-void Device::resetAll() {
-  Device::_ssbBfo = 11995000L;
-  Device::_cwBfo = 11995000L;
-  Device::_cwTone = 700;
-  Device::_cwWpm = 15;
-  Device::_cwWpmLow = 15;
-  Device::_cwSpeed = 1200 / Device::_cwWpm;
-  Device::_cwDelay = 500;
-  Device::_cwKey = CW_KEY_IAMBIC_B_R;
-}
+  Device::invalidateHardware();
 
-void Device::loadSettings() {
-  eeprom_read_cw_tone(Device::_cwTone);
-  eeprom_read_cw_wpm(Device::_cwWpm);
-  eeprom_read_cw_wpm_low(Device::_cwWpmLow);
-  Device::_cwSpeed = 1200 / Device::_cwWpm;
-  eeprom_read_cw_delay(Device::_cwDelay);
-  eeprom_read_cw_key(Device::_cwKey);
+  catTask.setBaud(settings.cat_baud);
+}
 
-  eeprom_read_master_cali(calibration);
-  eeprom_read_ssb_bfo(Device::_ssbBfo);
-  eeprom_read_cw_bfo(Device::_cwBfo);
+void Device::resetAll() {
+  settings.ssb_bfo = 11995000L;
+  settings.cw_bfo = 11995000L;
+  settings.cw_tone = 700;
+  settings.cw_wpm = 15;
+  settings.cw_wpm_low = 15;
+  settings.cw_delay = 500;
+  settings.cw_key = CW_KEY_IAMBIC_B_R;
+  settings.i2c_fast = OFF;
+  settings.master_cali = 0;
+  settings.cat_baud = CAT_BAUD_19200;
 
+  Device::loadSettings();
 }
 
-void Device::saveSettings() {
-  eeprom_write_cw_tone(Device::_cwTone);
-  eeprom_write_cw_wpm(Device::_cwWpm);
-  eeprom_write_cw_wpm(Device::_cwWpmLow);
-  eeprom_write_cw_delay(Device::_cwDelay);
-  eeprom_write_cw_key(Device::_cwKey);
-
-  eeprom_write_master_cali(calibration);
-  eeprom_write_ssb_bfo(Device::_ssbBfo);
-  eeprom_write_cw_bfo(Device::_cwBfo);
+// Applies the settings block to the runtime values
+void Device::loadSettings() {
+  Device::_cwSpeed = 1200 / settings.cw_wpm;
+  calibration = settings.master_cali;
 }
 
 void Device::setFreqMode(int32_t freq, uint8_t mode, uint8_t tx) {
@@ -1057,70 +1377,92 @@ void Device::setFreqMode(int32_t freq, uint8_t mode, uint8_t tx) {
 void Device::updateHardware() {
   Device::setTxFilters(_freq);
 
-  digitalWrite(TX_RX, _tx == ON ? HIGH : LOW);
+  if (_hwTx != _tx) {
+    digitalWrite(TX_RX, _tx == ON ? HIGH : LOW);
+    _hwTx = _tx;
+  }
 
   if (_mode == MODE_CW || _mode == MODE_CWR) {
-    usbCarrier = Device::_cwBfo;
+    usbCarrier = settings.cw_bfo;
   } else {
-    usbCarrier = Device::_ssbBfo;
+    usbCarrier = settings.ssb_bfo;
   }
 
+  // Only the clocks whose frequency really changed are reprogrammed, all in
+  // one commit. Tuning within a mode touches CLK2 only.
   if (_tx == OFF) {
-    si5351bx_setfreq(0, usbCarrier);
+    Device::setClock(0, usbCarrier);
 
     int32_t f = _freq;
-    if (_mode == MODE_CW) f = _freq - Device::_cwTone;
-    else if (_mode == MODE_CWR) f = _freq + Device::_cwTone;
+    if (_mode == MODE_CW) f = _freq - settings.cw_tone;
+    else if (_mode == MODE_CWR) f = _freq + settings.cw_tone;
 
     if (_mode == MODE_USB || _mode == MODE_CW) {
-      si5351bx_setfreq(2, SECOND_OSC_USB - usbCarrier + f);
-      si5351bx_setfreq(1, SECOND_OSC_USB);
+      Device::setClock(2, SECOND_OSC_USB - usbCarrier + f);
+      Device::setClock(1, SECOND_OSC_USB);
     } else {
-      si5351bx_setfreq(2, SECOND_OSC_LSB + usbCarrier + f);
-      si5351bx_setfreq(1, SECOND_OSC_LSB);
+      Device::setClock(2, SECOND_OSC_LSB + usbCarrier + f);
+      Device::setClock(1, SECOND_OSC_LSB);
     }
   } else {
     if (_mode == MODE_USB) {
-      si5351bx_setfreq(0, usbCarrier);
-      si5351bx_setfreq(2, SECOND_OSC_USB - usbCarrier + _freq);
-      si5351bx_setfreq(1, SECOND_OSC_USB);
+      Device::setClock(0, usbCarrier);
+      Device::setClock(2, SECOND_OSC_USB - usbCarrier + _freq);
+      Device::setClock(1, SECOND_OSC_USB);
     } else if (_mode == MODE_LSB) {
-      si5351bx_setfreq(0, usbCarrier);
-      si5351bx_setfreq(2, SECOND_OSC_LSB + usbCarrier + _freq);
-      si5351bx_setfreq(1, SECOND_OSC_LSB);
+      Device::setClock(0, usbCarrier);
+      Device::setClock(2, SECOND_OSC_LSB + usbCarrier + _freq);
+      Device::setClock(1, SECOND_OSC_LSB);
     } else {
-      si5351bx_setfreq(0, usbCarrier);
-      si5351bx_setfreq(2, _freq);
-      si5351bx_setfreq(1, 0);
+      Device::setClock(0, usbCarrier);
+      Device::setClock(2, _freq);
+      Device::setClock(1, 0);
     }
   }
+
+  si5351bx_commit();
+}
+
+// Forget the cached hardware state, the next updateHardware rewrites all.
+// Needed after the oscillators or relays were driven directly.
+void Device::invalidateHardware() {
+  _hwLpf = -1;
+  _hwTx = -1;
+  _hwClk[0] = _hwClk[1] = _hwClk[2] = 0xFFFFFFFFL;
+}
+
+void Device::setClock(uint8_t clk, uint32_t freq) {
+  if (_hwClk[clk] != freq) {
+    si5351bx_stagefreq(clk, freq);
+    _hwClk[clk] = freq;
+  }
 }
 
 void Device::setCwTone(int16_t cwTone) {
-  Device::_cwTone = cwTone;
+  settings.cw_tone = cwTone;
 
   Device::updateHardware();
 
-  eeprom_write_cw_tone(Device::_cwTone);
+  settings_save();
 }
 
 int16_t Device::getCwTone() {
-  return Device::_cwTone;
+  return settings.cw_tone;
 }
 
 void Device::setCwWpm(uint8_t wpm) {
-  Device::_cwWpm = wpm;
-  Device::_cwSpeed = 1200 / Device::_cwWpm;
+  settings.cw_wpm = wpm;
+  Device::_cwSpeed = 1200 / settings.cw_wpm;
 
-  eeprom_write_cw_wpm(Device::_cwWpm);
+  settings_save();
 }
 
 void Device::selectCwSpeed(bool isNormal) {
-  Device::_cwSpeed = 1200 / (isNormal ? Device::_cwWpm : Device::_cwWpmLow);
+  Device::_cwSpeed = 1200 / (isNormal ? settings.cw_wpm : settings.cw_wpm_low);
 }
 
 uint8_t Device::getCwWpm() {
-  return Device::_cwWpm;
+  return settings.cw_wpm;
 }
 
 uint16_t Device::getCwSpeed() {
@@ -1128,23 +1470,47 @@ uint16_t Device::getCwSpeed() {
 }
 
 void Device::setCwDelay(uint16_t cwDelay) {
-  Device::_cwDelay = cwDelay;
+  settings.cw_delay = cwDelay;
 
-  eeprom_write_cw_delay(Device::_cwDelay);
+  settings_save();
 }
 
 uint16_t Device::getCwDelay() {
-  return Device::_cwDelay;
+  return settings.cw_delay;
 }
 
 void Device::setCwKey(uint8_t key) {
-  Device::_cwKey = key;
+  settings.cw_key = key;
 
-  eeprom_write_cw_key(Device::_cwKey);
+  settings_save();
 }
 
 uint8_t Device::getCwKey() {
-  return Device::_cwKey;
+  return settings.cw_key;
+}
+
+void Device::setI2cFast(uint8_t fast) {
+  settings.i2c_fast = fast;
+
+  si5351bx_set_i2c_fast(settings.i2c_fast);
+
+  settings_save();
+}
+
+uint8_t Device::getI2cFast() {
+  return settings.i2c_fast;
+}
+
+void Device::setCatBaud(uint8_t baud) {
+  settings.cat_baud = baud;
+
+  catTask.setBaud(settings.cat_baud);
+
+  settings_save();
+}
+
+uint8_t Device::getCatBaud() {
+  return settings.cat_baud;
 }
 
 void Device::cwKeyDown() {
@@ -1159,20 +1525,22 @@ void Device::cwTone(uint8_t cwToneState) {
   if (cwToneState == OFF) {
     noTone(CW_TONE);
   } else {
-    tone(CW_TONE, Device::_cwTone);
+    tone(CW_TONE, settings.cw_tone);
   }
 }
 
 void Device::startCalibrate10M() {
+  Device::invalidateHardware();
   Device::setTxFilters(10000000L);
 
   si5351_set_calibration(calibration);
 
   digitalWrite(TX_RX, 1);
 
-  si5351bx_setfreq(0, 0);
-  si5351bx_setfreq(1, 0);
-  si5351bx_setfreq(2, 10000000L);
+  si5351bx_stagefreq(0, 0);
+  si5351bx_stagefreq(1, 0);
+  si5351bx_stagefreq(2, 10000000L);
+  si5351bx_commit();
 
   digitalWrite(CW_KEY, 1);
 }
@@ -1183,12 +1551,16 @@ void Device::updateCalibrate10M() {
 }
 
 void Device::stopCalibrate10M(bool save) {
-  if (save) eeprom_write_master_cali(calibration);
+  if (save) {
+    settings.master_cali = calibration;
+    settings_save();
+  }
 
   digitalWrite(CW_KEY, 0);
   digitalWrite(TX_RX, 0);
 
   si5351_set_calibration(calibration);
+  Device::invalidateHardware();
   Device::updateHardware();
 }
 
@@ -1198,18 +1570,27 @@ void Device::startCalibrate0beat() {
 
 void Device::updateCalibrate0beat() {
   si5351_set_calibration(calibration);
+  Device::invalidateHardware();
 
   Device::updateHardware();
 }
 
 void Device::stopCalibrate0beat(bool save) {
-  if (save) eeprom_write_master_cali(calibration);
+  if (save) {
+    settings.master_cali = calibration;
+    settings_save();
+  }
 
   si5351_set_calibration(calibration);
+  Device::invalidateHardware();
   Device::updateHardware();
 }
 
 void Device::startCalibrateBfo() {
+  uint8_t mode = rig.getRxMode();
+
+  Device::_calBfo = (mode == MODE_CW || mode == MODE_CWR) ? settings.cw_bfo : settings.ssb_bfo;
+
   Device::updateHardware();
 }
 
@@ -1217,9 +1598,9 @@ void Device::updateCalibrateBfo() {
   uint8_t mode = rig.getRxMode();
 
   if (mode == MODE_CW || mode == MODE_CWR) {
-    Device::_cwBfo = usbCarrier;
+    settings.cw_bfo = usbCarrier;
   } else {
-    Device::_ssbBfo = usbCarrier;
+    settings.ssb_bfo = usbCarrier;
   }
 
   Device::updateHardware();
@@ -1227,12 +1608,14 @@ void Device::updateCalibrateBfo() {
 
 void Device::stopCalibrateBfo(bool save) {
   if (save) {
+    settings_save();
+  } else {
     uint8_t mode = rig.getRxMode();
 
     if (mode == MODE_CW || mode == MODE_CWR) {
-      eeprom_write_cw_bfo(Device::_cwBfo);
+      settings.cw_bfo = Device::_calBfo;
     } else {
-      eeprom_write_ssb_bfo(Device::_ssbBfo);
+      settings.ssb_bfo = Device::_calBfo;
     }
   }
 
@@ -1256,15 +1639,26 @@ void Device::stopCalibrateBfo(bool save) {
  */
 
 void Device::setTxFilters(int32_t freq) {
-  if (freq > 21000000L) {  // the default filter is with 35 MHz cut-off
+  int8_t lpf;
+
+  if (freq > 21000000L) lpf = 0;
+  else if (freq >= 14000000L) lpf = 1;
+  else if (freq > 7000000L) lpf = 2;
+  else lpf = 3;
+
+  // The relays are only switched when the band changes
+  if (lpf == _hwLpf) return;
+  _hwLpf = lpf;
+
+  if (lpf == 0) {  // the default filter is with 35 MHz cut-off
     digitalWrite(TX_LPF_A, 0);
     digitalWrite(TX_LPF_B, 0);
     digitalWrite(TX_LPF_C, 0);
-  } else if (freq >= 14000000L) { //thrown the KT1 relay on, the 30 MHz LPF is bypassed and the 14-18 MHz LPF is allowd to go through
+  } else if (lpf == 1) { //thrown the KT1 relay on, the 30 MHz LPF is bypassed and the 14-18 MHz LPF is allowd to go through
     digitalWrite(TX_LPF_A, 1);
     digitalWrite(TX_LPF_B, 0);
     digitalWrite(TX_LPF_C, 0);
-  } else if (freq > 7000000L) {
+  } else if (lpf == 2) {
     digitalWrite(TX_LPF_A, 1);
     digitalWrite(TX_LPF_B, 1);
     digitalWrite(TX_LPF_C, 0);
@@ -18,6 +18,7 @@
 
 #include <stdint.h>
 #include "ui_tasks.h"
+#include "bcd.h"
 #include "objs.h"
 
 #define MIN_FREQ 500000
@@ -38,6 +39,8 @@
 
 #define MEM_SIZE 20 // provides channel#00 to channel#19
 
+#define EEPROM_BLOCK_SIZE 32 // for the binary backup and restore
+
 #pragma pack(push, 1)
 
 // 5 bytes
@@ -71,6 +74,12 @@ public:
 
   int32_t getFreqAnother();
 
+  int32_t getVfoFreq(uint8_t idx);
+  uint8_t getVfoMode(uint8_t idx);
+
+  // getFreq() in CI-V BCD, cached for the CAT polls
+  const uint8_t *getFreqBcd();
+
   bool setMode(uint8_t mode, bool need_update = true);
 
   uint8_t getRxMode();
@@ -115,6 +124,10 @@ public:
 
   void clearMemory(bool need_update = true);
 
+  // Direct access to any channel, without selecting it. NULL clears it.
+  bool readMemCh(int8_t ch_idx, Channel &ch);
+  bool writeMemCh(int8_t ch_idx, const Channel *ch, bool need_update = true);
+
   bool isVfo();
 
   bool isMemOk();
@@ -126,6 +139,7 @@ public:
   void resetAll();
 
   void saveVfoCh();
+  void flushEeprom();
   void setFreqAdjBase(int32_t base);
   int32_t getFreqAdjBase();
 
@@ -138,22 +152,28 @@ public:
   bool writeEepromBcd(uint16_t addr, uint8_t len, const uint8_t *data);
   bool readEepromBcd(uint16_t addr, uint8_t len, uint8_t *data);
 
+  bool writeEepromBlock(uint8_t blk, const uint8_t *data);
+  bool readEepromBlock(uint8_t blk, uint8_t *data);
+
   void serialSetup();
 private:
   uint8_t _tx;
-  uint8_t _dial_lock;
-  bool _is_vfo;
-  int32_t _freq_adj_base;
-  uint8_t _rgn;
 
   Channel *_working_ch;
   Channel _vfo_ch;
   Channel _vfo_ch_saved;
   //Channel _mem[MEM_SIZE];
   Channel _mem_ch;
-  int8_t _ch_idx;
+  uint32_t _mem_ok_bits; // bit n set: channel#n is not empty
+
+  int32_t _bcd_freq;
+  uint8_t _freq_bcd[FREQ_BCD_LEN];
 
+  void resetSettings();
   void updateDeviceFreqMode();
+  void loadMemOkBits();
+  void setMemOkBit(int8_t ch_idx, const Channel &ch);
+  void reloadEeprom(uint16_t addr, uint16_t len);
 };
 
 #define CW_KEY_STRAIGHT (0)
@@ -162,6 +182,15 @@ private:
 #define CW_KEY_IAMBIC_B_L (3)
 #define CW_KEY_IAMBIC_B_R (4)
 
+// CAT serial rates, in the order of the menu. 0 is the old fixed rate.
+#define CAT_BAUD_19200 (0)
+#define CAT_BAUD_9600 (1)
+#define CAT_BAUD_38400 (2)
+#define CAT_BAUD_57600 (3)
+#define CAT_BAUD_115200 (4)
+#define CAT_BAUD_AUTO (5)
+#define CAT_BAUD_COUNT (6)
+
 class Device {
 public:
   Device();
@@ -186,6 +215,12 @@ public:
   static void setCwKey(uint8_t cwKey);
   static uint8_t getCwKey();
 
+  static void setI2cFast(uint8_t fast);
+  static uint8_t getI2cFast();
+
+  static void setCatBaud(uint8_t baud);
+  static uint8_t getCatBaud();
+
   static void cwKeyDown();
   static void cwKeyUp();
 
@@ -204,26 +239,35 @@ public:
   static void stopCalibrateBfo(bool save = true);
 
   static void loadSettings();
-  static void saveSettings();
+  static void invalidateHardware();
 private:
-  static uint32_t _ssbBfo, _cwBfo;
-  static uint16_t _cwTone;
-  static uint8_t _cwWpm;
-  static uint8_t _cwWpmLow;
   static uint16_t _cwSpeed;
-  static uint16_t _cwDelay;
-  static uint8_t _cwKey;
 
   static int32_t _freq;
   static uint8_t _mode, _tx;
 
+  // What the hardware is currently set to, for applying only the deltas
+  static int8_t _hwLpf;
+  static int8_t _hwTx;
+  static uint32_t _hwClk[3];
+
+  // The BFO before its calibration, restored on cancel
+  static uint32_t _calBfo;
+
+  static void setClock(uint8_t clk, uint32_t freq);
   static void setTxFilters(int32_t freq);
 };
 
 extern uint32_t usbCarrier;
 extern int32_t calibration;
+extern uint8_t si5351bx_i2c_fast;
+extern uint16_t si5351bx_commit_us;
+extern uint16_t si5351bx_commit_us_max;
 
 void si5351bx_setfreq(uint8_t clknum, uint32_t fout);
+void si5351bx_stagefreq(uint8_t clknum, uint32_t fout);
+void si5351bx_commit();
+void si5351bx_set_i2c_fast(uint8_t fast);
 void si5351_set_calibration(int32_t cal);
 void initOscillators();
 
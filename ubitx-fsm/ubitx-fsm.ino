@@ -20,6 +20,7 @@
 #include "ui_tasks.h"
 #include "keyer_task.h"
 #include "rig.h"
+#include "bench.h"
 
 FsmOs fsmOs(7);
 
@@ -33,6 +34,10 @@ void setup() {
   fsmOs.addTask(&keyerTask);
 
   fsmOs.init();
+
+#ifdef UBITX_BENCH
+  bench_run();
+#endif
 }
 
 void loop() {
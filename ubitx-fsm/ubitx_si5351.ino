@@ -10,6 +10,12 @@
 // Call si5351bx_setfreq(clknum, freq) each time one of the
 // three output CLK pins is to be updated to a new frequency.
 // A freq of 0 serves to shut down that output clock.
+// The registers are shadowed in RAM, so calling it again with an unchanged
+// freq costs no I2C traffic, and a small change only sends the msynth bytes
+// that differ.
+// To move several clocks at once, call si5351bx_stagefreq(clknum, freq) for
+// each of them and then si5351bx_commit(). That sends all msynth changes in
+// one burst and enables the outputs with a single reg 3 write at the end.
 
 // The global variable si5351bx_vcoa starts out equal to the nominal VCOA
 // frequency of 25mhz*35 = 875000000 Hz.  To correct for 25mhz crystal errors,
@@ -48,8 +54,28 @@ uint32_t si5351bx_vcoa = (SI5351BX_XTAL*SI5351BX_MSA);  // 25mhzXtal calibrate
 uint8_t  si5351bx_rdiv = 0;             // 0-7, CLK pin sees fout/(2**rdiv)
 uint8_t  si5351bx_drive[3] = {1, 1, 1}; // 0=2ma 1=4ma 2=6ma 3=8ma for CLK 0,1,2
 uint8_t  si5351bx_clken = 0xFF;         // Private, all CLK output drivers off
+uint8_t  si5351bx_i2c_fast = 0;         // 0: 100khz, 1: 400khz fast-mode I2C
 int32_t calibration = 0;
 
+// Staged register images and a RAM shadow of what was last sent to the
+// Si5351. A commit only puts the bytes that really changed on the bus.
+uint8_t  si5351bx_ms[24];               // msynth regs 42-49, 50-57, 58-65
+uint8_t  si5351bx_ms_shadow[24];
+uint8_t  si5351bx_ctl[3];               // CLK control regs 16, 17, 18
+uint8_t  si5351bx_ctl_shadow[3];
+uint8_t  si5351bx_clken_shadow;         // reg 3
+uint8_t  si5351bx_shadow_ok = 0;        // Bit n: CLKn shadow valid
+
+// Bus time of the last commit that sent anything, and the worst one seen
+uint16_t si5351bx_commit_us = 0;
+uint16_t si5351bx_commit_us_max = 0;
+
+// The VFO clock is retuned all the time. Its last a+b/c split is kept so
+// that small steps are done without the 32 bit division.
+#define SI5351BX_FAST_CLK 2
+uint32_t si5351bx_fast_fout = 0;        // 0: nothing kept yet
+uint32_t si5351bx_fast_vcoa, si5351bx_fast_msa, si5351bx_fast_msb;
+
 void i2cWrite(uint8_t reg, uint8_t val) {   // write reg via i2c
   Wire.beginTransmission(SI5351BX_ADDR);
   Wire.write(reg);
@@ -64,12 +90,29 @@ void i2cWriten(uint8_t reg, uint8_t *vals, uint8_t vcnt) {  // write array
   Wire.endTransmission();
 }
 
+bool si5351bx_write_diff(uint8_t reg, uint8_t *vals, uint8_t *shadow, uint8_t n) {
+  uint8_t first = 0, last = n - 1;
+  while (first < n && vals[first] == shadow[first]) first++;
+  if (first == n) return false;         // nothing changed
+  while (vals[last] == shadow[last]) last--;
+  i2cWriten(reg + first, vals + first, last - first + 1);  // one burst
+  memcpy(shadow + first, vals + first, last - first + 1);
+  return true;
+}
+
+void si5351bx_set_i2c_fast(uint8_t fast) {
+  si5351bx_i2c_fast = fast;
+  Wire.setClock(fast ? 400000L : 100000L);
+}
 
 void si5351bx_init() {                  // Call once at power-up, start PLLA
   /*uint8_t reg;*/  uint32_t msxp1;
   Wire.begin();
+  si5351bx_set_i2c_fast(si5351bx_i2c_fast);
   i2cWrite(149, 0);                     // SpreadSpectrum off
+  si5351bx_shadow_ok = 0;               // Msynth regs unknown after power-up
   i2cWrite(3, si5351bx_clken);          // Disable all CLK output drivers
+  si5351bx_clken_shadow = si5351bx_clken;
   i2cWrite(183, SI5351BX_XTALPF << 6);  // Set 25mhz crystal load capacitance
   msxp1 = 128 * SI5351BX_MSA - 512;     // and msxp2=0, msxp3=1, not fractional
   uint8_t  vals[8] = {0, 1, BB2(msxp1), BB1(msxp1), BB0(msxp1), 0, 0, 0};
@@ -79,29 +122,97 @@ void si5351bx_init() {                  // Call once at power-up, start PLLA
   // i2cWrite(187, 0);                  // No fannout of clkin, xtal, ms0, ms4
 }
 
-void si5351bx_setfreq(uint8_t clknum, uint32_t fout) {  // Set a CLK to fout Hz
+// vcoa == msa * fout + msb for the kept fout. Moving fout by d keeps msa as
+// long as msb - msa * d stays within 0..fout-1, which needs no division.
+bool si5351bx_fast_step(uint32_t fout, uint32_t *msa, uint32_t *msb) {
+  uint32_t d;
+  if (si5351bx_fast_fout == 0 || si5351bx_fast_vcoa != si5351bx_vcoa)
+    return false;
+  if (fout >= si5351bx_fast_fout) {
+    d = fout - si5351bx_fast_fout;
+    if (d & 0xfff00000) return false;   // Keeps msa * d within 32 bits
+    d *= si5351bx_fast_msa;
+    if (d > si5351bx_fast_msb) return false;  // Integer part changes
+    *msb = si5351bx_fast_msb - d;
+  } else {
+    d = si5351bx_fast_fout - fout;
+    if (d & 0xfff00000) return false;
+    *msb = si5351bx_fast_msb + d * si5351bx_fast_msa;
+    if (*msb >= fout) return false;     // Integer part changes
+  }
+  *msa = si5351bx_fast_msa;
+  return true;
+}
+
+void si5351bx_stagefreq(uint8_t clknum, uint32_t fout) {  // Stage CLK at fout Hz
   uint32_t  msa, msb, msc, msxp1, msxp2, msxp3p2top;
   if ((fout < 500000) || (fout > 109000000)) // If clock freq out of range
     si5351bx_clken |= 1 << clknum;      //  shut down the clock
   else {
-    msa = si5351bx_vcoa / fout;     // Integer part of vco/fout
-    msb = si5351bx_vcoa % fout;     // Fractional part of vco/fout
+    if (clknum != SI5351BX_FAST_CLK || !si5351bx_fast_step(fout, &msa, &msb)) {
+      msa = si5351bx_vcoa / fout;   // Integer part of vco/fout
+      msb = si5351bx_vcoa % fout;   // Fractional part of vco/fout
+    }
+    if (clknum == SI5351BX_FAST_CLK) {
+      si5351bx_fast_fout = fout;
+      si5351bx_fast_vcoa = si5351bx_vcoa;
+      si5351bx_fast_msa = msa;
+      si5351bx_fast_msb = msb;
+    }
     msc = fout;             // Divide by 2 till fits in reg
     while (msc & 0xfff00000) {
       msb = msb >> 1;
       msc = msc >> 1;
     }
-    msxp1 = (128 * msa + 128 * msb / msc - 512) | (((uint32_t)si5351bx_rdiv) << 20);
-    msxp2 = 128 * msb - 128 * msb / msc * msc; // msxp3 == msc;
+    msxp1 = 0;              // 128 * msb / msc by shift and subtract
+    for (uint8_t i = 0; ; i++) {
+      if (msb >= msc) {
+        msb -= msc;
+        msxp1 |= 1;
+      }
+      if (i == 7) break;
+      msb <<= 1;
+      msxp1 <<= 1;
+    }
+    msxp2 = msb;            // The remainder, msxp3 == msc;
+    msxp1 = (128 * msa + msxp1 - 512) | (((uint32_t)si5351bx_rdiv) << 20);
     msxp3p2top = (((msc & 0x0F0000) << 4) | msxp2);     // 2 top nibbles
-    uint8_t vals[8] = { BB1(msc), BB0(msc), BB2(msxp1), BB1(msxp1),
-                        BB0(msxp1), BB2(msxp3p2top), BB1(msxp2), BB0(msxp2)
-                      };
-    i2cWriten(42 + (clknum * 8), vals, 8); // Write to 8 msynth regs
-    i2cWrite(16 + clknum, 0x0C | si5351bx_drive[clknum]); // use local msynth
+    uint8_t *vals = &si5351bx_ms[clknum * 8];
+    vals[0] = BB1(msc);
+    vals[1] = BB0(msc);
+    vals[2] = BB2(msxp1);
+    vals[3] = BB1(msxp1);
+    vals[4] = BB0(msxp1);
+    vals[5] = BB2(msxp3p2top);
+    vals[6] = BB1(msxp2);
+    vals[7] = BB0(msxp2);
+    si5351bx_ctl[clknum] = 0x0C | si5351bx_drive[clknum]; // use local msynth
+    if (!(si5351bx_shadow_ok & (1 << clknum))) {  // Unknown chip state,
+      for (uint8_t i = 0; i < 8; i++)           // force a full write
+        si5351bx_ms_shadow[clknum * 8 + i] = ~vals[i];
+      si5351bx_ctl_shadow[clknum] = ~si5351bx_ctl[clknum];
+      si5351bx_shadow_ok |= 1 << clknum;
+    }
     si5351bx_clken &= ~(1 << clknum);   // Clear bit to enable clock
   }
-  i2cWrite(3, si5351bx_clken);        // Enable/disable clock
+}
+
+void si5351bx_commit() {                // Send all staged changes
+  uint32_t t = micros();
+  bool sent = si5351bx_write_diff(42, si5351bx_ms, si5351bx_ms_shadow, 24);
+  sent |= si5351bx_write_diff(16, si5351bx_ctl, si5351bx_ctl_shadow, 3);
+  sent |= si5351bx_write_diff(3, &si5351bx_clken, &si5351bx_clken_shadow, 1);  // Enable/disable clocks
+  if (sent) {
+    t = micros() - t;
+    si5351bx_commit_us = t > 0xFFFF ? 0xFFFF : t;
+    if (si5351bx_commit_us > si5351bx_commit_us_max)
+      si5351bx_commit_us_max = si5351bx_commit_us;
+  }
+}
+
+void si5351bx_setfreq(uint8_t clknum, uint32_t fout) {  // Set a CLK to fout Hz
+  si5351bx_stagefreq(clknum, fout);
+  si5351bx_commit();
 }
 
 void si5351_set_calibration(int32_t cal){
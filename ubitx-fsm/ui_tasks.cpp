@@ -19,6 +19,7 @@
 #include "display_task.h"
 #include "keyer_task.h"
 #include "rig.h"
+#include "bcd.h"
 #include "objs.h"
 
 #define ANALOG_KEYER (A6)
@@ -76,16 +77,56 @@ unsigned long ButtonInputTask::getButtonPressAt() {
   return _press_at;
 }
 
-#define ENCODER_WAIT_NEW_VALUE (FSM_STATE_USERDEF + 1)
-#define ENCODER_DEAL_NEW_VALUE (FSM_STATE_USERDEF + 2)
+#define ENCODER_RUNNING (FSM_STATE_USERDEF + 1)
+
+// The encoder is decoded on every edge of A or B, from the previous and
+// the new AB state. Invalid (bouncing) transitions count 0.
+static const int8_t enc_transition_table[16] PROGMEM = {
+// new: 0   1   2   3      old
+        0, +1, -1,  0,  // 0
+       -1,  0,  0, +1,  // 1
+       +1,  0,  0, -1,  // 2
+        0, -1, +1,  0   // 3
+};
+
+// Edges closer than this are contact bounce. The old decoder confirmed
+// each state after 2ms.
+#define ENC_MIN_EDGE_US (1000)
+
+static volatile uint8_t enc_ab = 3;
+static volatile int16_t enc_count = 0;
+static volatile unsigned long enc_edge_at = 0; // micros
+
+static inline void enc_decode(uint8_t ab) {
+  if (ab == enc_ab) return;
+
+  unsigned long now = micros();
+  if (now - enc_edge_at < ENC_MIN_EDGE_US) return;
+
+  enc_count += (int8_t)pgm_read_byte(&enc_transition_table[(enc_ab << 2) | ab]);
+  enc_ab = ab;
+  enc_edge_at = now;
+}
+
+#ifdef __AVR__
+
+static volatile uint8_t *enc_pin_reg_a, *enc_pin_reg_b;
+static uint8_t enc_bit_a, enc_bit_b;
+
+// A0 and A1 are on port C
+ISR(PCINT1_vect) {
+  enc_decode(((*enc_pin_reg_a & enc_bit_a) ? 1 : 0) + ((*enc_pin_reg_b & enc_bit_b) ? 2 : 0));
+}
+
+#endif
 
 EncoderTask::EncoderTask(uint8_t pin_a, uint8_t pin_b) {
   _pin_a = pin_a;
   _pin_b = pin_b;
 
-  _enc_state = _new_enc_state = 3;
-
   _value = _current_value = 0;
+  _window_steps = 0;
+  _steps = 0;
 
   _calc_at = millis();
 }
@@ -94,55 +135,47 @@ void EncoderTask::init() {
   pinMode(_pin_a, INPUT_PULLUP);
   pinMode(_pin_b, INPUT_PULLUP);
 
-  gotoState(ENCODER_WAIT_NEW_VALUE);
-}
+  enc_ab = (digitalRead(_pin_a) ? 1 : 0) + (digitalRead(_pin_b) ? 2 : 0);
 
-bool EncoderTask::on_state_change(int8_t new_state, int8_t) {
-  switch (new_state) {
-  case ENCODER_DEAL_NEW_VALUE:
-    if (read_encoder() == _new_enc_state && _new_enc_state != _enc_state) {
-      if ((_enc_state == 0 && _new_enc_state == 2) ||
-        (_enc_state == 2 && _new_enc_state == 3) ||
-        (_enc_state == 3 && _new_enc_state == 1) ||
-        (_enc_state == 1 && _new_enc_state == 0)) {
-        _current_value --;
-      }
-      if ((_enc_state == 0 && _new_enc_state == 1) ||
-        (_enc_state == 1 && _new_enc_state == 3) ||
-        (_enc_state == 3 && _new_enc_state == 2) ||
-        (_enc_state == 2 && _new_enc_state == 0)) {
-        _current_value ++;
-      }
+#ifdef __AVR__
+  enc_pin_reg_a = portInputRegister(digitalPinToPort(_pin_a));
+  enc_pin_reg_b = portInputRegister(digitalPinToPort(_pin_b));
+  enc_bit_a = digitalPinToBitMask(_pin_a);
+  enc_bit_b = digitalPinToBitMask(_pin_b);
 
-      _enc_state = _new_enc_state;
-    }
-    delay(2, ENCODER_WAIT_NEW_VALUE);
-    break;
+  *digitalPinToPCMSK(_pin_a) |= _BV(digitalPinToPCMSKbit(_pin_a));
+  *digitalPinToPCMSK(_pin_b) |= _BV(digitalPinToPCMSKbit(_pin_b));
+  *digitalPinToPCICR(_pin_a) |= _BV(digitalPinToPCICRbit(_pin_a));
+#endif
 
-  default:
-    break;
-  }
+  gotoState(ENCODER_RUNNING);
+}
+
+bool EncoderTask::on_state_change(int8_t, int8_t) {
   return true;
 }
 
-void EncoderTask::in_state(int8_t state) {
+void EncoderTask::in_state(int8_t) {
+#ifndef __AVR__
+  enc_decode((digitalRead(_pin_a) ? 1 : 0) + (digitalRead(_pin_b) ? 2 : 0));
+#endif
+
+  noInterrupts();
+  int16_t d = enc_count;
+  enc_count = 0;
+  interrupts();
+
+  _current_value += d;
+  _steps += d;
+
   if (millis() - _calc_at >= 100) {
-    _value = _current_value;
+    if (_current_value > 127) _value = 127;
+    else if (_current_value < -127) _value = -127;
+    else _value = _current_value;
+    _window_steps = _current_value;
     _current_value = 0;
     _calc_at = millis();
   }
-
-  switch (state) {
-  case ENCODER_WAIT_NEW_VALUE:
-    _new_enc_state = read_encoder();
-    if (_new_enc_state != _enc_state) {
-      delay(2, ENCODER_DEAL_NEW_VALUE);
-    }
-    break;
-
-  default:
-    break;
-  }
 }
 
 int8_t EncoderTask::get_value() {
@@ -153,8 +186,23 @@ void EncoderTask::reset_value() {
   _value = 0;
 }
 
-uint8_t EncoderTask::read_encoder() {
-  return (analogRead(_pin_a) > 500 ? 1 : 0) + (analogRead(_pin_b) > 500 ? 2: 0);
+int16_t EncoderTask::take_steps() {
+  int16_t steps = _steps;
+  _steps = 0;
+
+  return steps;
+}
+
+// n steps per 100ms: 1 below 3, n - 2 above, as the 100ms window did. n is
+// of the last full window, or of the current one once it has more.
+uint8_t EncoderTask::get_speed_factor() {
+  int16_t n = abs(_window_steps);
+  int16_t c = abs(_current_value);
+  if (c > n) n = c;
+
+  if (n > 100) n = 100;
+
+  return n < 3 ? 1 : n - 2;
 }
 
 #define MENU_WELCOME (FSM_STATE_USERDEF + 1)
@@ -241,6 +289,9 @@ bool UiTask::on_state_change(int8_t new_state, int8_t old_state) {
 }
 
 void UiTask::in_state(int8_t state) {
+  // write back one pending EEPROM byte
+  rig.flushEeprom();
+
   // read inputs
   bool fbtn_change = false;
   uint8_t fbtn_from_state = _last_fbutton_state;
@@ -274,9 +325,11 @@ void UiTask::in_state(int8_t state) {
 
   int8_t enc_val = encoderTask.get_value();
   encoderTask.reset_value();
+  int16_t enc_steps = encoderTask.take_steps();
 
   if (_last_fbutton_state != FBTN_UP) {
     enc_val = 0;
+    enc_steps = 0;
   }
 
   // Calibrate?
@@ -410,7 +463,7 @@ void UiTask::in_state(int8_t state) {
 
   switch (state) {
   case MENU_NONE:
-    in_state_menu_none(fbtn_change, fbtn_from_state, enc_val);
+    in_state_menu_none(fbtn_change, fbtn_from_state, enc_val, enc_steps);
     break;
   case MENU_MAIN:
     in_state_menu_main(fbtn_change, fbtn_from_state, enc_val);
@@ -513,7 +566,7 @@ void UiTask::in_state_menu_main(bool fbtn_change, uint8_t fbtn_from_state, int8_
   }
 }
 
-void UiTask::in_state_menu_none(bool fbtn_change, uint8_t fbtn_from_state, int8_t enc_val) {
+void UiTask::in_state_menu_none(bool fbtn_change, uint8_t fbtn_from_state, int8_t enc_val, int16_t enc_steps) {
   if (fbtn_change) {
     if (_last_fbutton_state == FBTN_UP) {
       if (_current_state == MENU_NONE) {
@@ -526,15 +579,16 @@ void UiTask::in_state_menu_none(bool fbtn_change, uint8_t fbtn_from_state, int8_
         gotoState(MENU_FREQ_ADJ_BASE);
       }
     }
-  } else if (enc_val != 0 && rig.getDialLock() != ON) {
+  } else if (rig.getDialLock() != ON) {
     if (rig.isVfo()) {
-      int8_t times = enc_val > 0 ? enc_val : -enc_val;
-      if (times < 3) times = 1;
-      else times -= 2;
+      if (enc_steps != 0) {
+        // every step, faster when spinning fast
+        int32_t d = (int32_t)enc_steps * encoderTask.get_speed_factor();
 
-      rig.setFreq(rig.getFreq() + enc_val * times * rig.getFreqAdjBase(), false);
-      update_display(this);
-    } else {
+        rig.setFreq(rig.getFreq() + d * rig.getFreqAdjBase(), false);
+        update_display(this);
+      }
+    } else if (enc_val != 0) {
       bool need_update = false;
 
       if (enc_val > 1) {
@@ -631,12 +685,10 @@ void UiTask::update_rig_display() {
   char _buf[17];
 
   // freq
-  int32_t freq = rig.getFreq();
-  sprintf(_buf, "%2" PRIu32 ".%05" PRIi32, freq / 1000000, (freq % 1000000) / 10);
+  format_freq(_buf, rig.getFreq());
   displayTask.print(8, 1, _buf);
 
-  freq = rig.getFreqAnother();
-  sprintf(_buf, "%2" PRIu32 ".%05" PRIi32, freq / 1000000, (freq % 1000000) / 10);
+  format_freq(_buf, rig.getFreqAnother());
   displayTask.print(8, 0, _buf);
 
   // mode
@@ -44,16 +44,21 @@ public:
   virtual bool on_state_change(int8_t, int8_t);
   virtual void in_state(int8_t);
 
+  // steps of the last 100ms, for the menus
   int8_t get_value();
   void reset_value();
+
+  // steps since the last call, and the multiplier for the spinning speed
+  int16_t take_steps();
+  uint8_t get_speed_factor();
 private:
   uint8_t _pin_a, _pin_b;
-  uint8_t _enc_state, _new_enc_state;
-  int8_t _value, _current_value;
+  int8_t _value;
+  int16_t _current_value; // may pass int8_t within the window on a fast spin
+  int16_t _window_steps; // of the last full window, for the speed
+  int16_t _steps;
 
   unsigned long _calc_at;
-
-  uint8_t read_encoder();
 };
 
 class UiTask : public FsmTask {
@@ -87,9 +92,13 @@ private:
 
   void format_mode(char *, uint8_t);
 
-  void in_state_menu_none(bool fbtn_change, uint8_t fbtn_from_state, int8_t enc_val);
+  void in_state_menu_none(bool fbtn_change, uint8_t fbtn_from_state, int8_t enc_val, int16_t enc_steps);
   void in_state_menu_main(bool fbtn_change, uint8_t fbtn_from_state, int8_t enc_val);
   void in_state_menu_freq_adj_base(bool fbtn_change, uint8_t fbtn_from_state, int8_t enc_val);
+
+#ifdef UBITX_BENCH
+  friend class Bench;
+#endif
 };
 
 #endif // __UI_TASKS_H__